@@ -0,0 +1,325 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.cpp
+
+  ==============================================================================
+*/
+
+#include "OfflineRenderer.h"
+
+namespace
+{
+    // Renders one chunk of the output per run of its thread, with its own
+    // plugin instance and its own reader since neither is shared between
+    // threads. The input runs on past the chunk by the latency of the
+    // instance, and is silence after the end of the file, so the chunk comes
+    // out lined up with the file and the last ones carry the tail.
+    class ChunkWorker : public juce::Thread
+    {
+    public:
+        ChunkWorker(std::unique_ptr<SaunaSizzlerAudioProcessor> instanceToUse,
+                    std::unique_ptr<juce::AudioFormatReader> readerToUse,
+                    int numChannelsToRender,
+                    int maxSamples,
+                    juce::uint64 sizzleSeedToUse)
+            : juce::Thread("Sauna chunk renderer"),
+              instance(std::move(instanceToUse)),
+              reader(std::move(readerToUse)),
+              numChannels(numChannelsToRender),
+              buffer(numChannelsToRender, maxSamples),
+              sizzleSeed(sizzleSeedToUse)
+        {
+        }
+        
+        ~ChunkWorker() override
+        {
+            stopThread(10000);
+        }
+        
+        void startChunk(juce::int64 newChunkStart, int newChunkLength, int warmUpSamples)
+        {
+            const auto warmUpStart = std::max<juce::int64>(0, newChunkStart - warmUpSamples);
+            renderStart = warmUpStart;
+            warmUpLength = static_cast<int>(newChunkStart - warmUpStart);
+            chunkLength = newChunkLength;
+            succeeded = false;
+            startThread();
+        }
+        
+        // Waits for the chunk, false if it could not be read
+        bool finishChunk()
+        {
+            waitForThreadToExit(-1);
+            return succeeded;
+        }
+        
+        const juce::AudioBuffer<float>& getBuffer() const { return buffer; }
+        int getChunkOffset() const { return chunkOffset; }
+        int getChunkLength() const { return chunkLength; }
+        
+    private:
+        void run() override
+        {
+            // A fresh start for every chunk, positioned where it is in the file
+            instance->prepareToPlay(reader->sampleRate, OfflineRenderer::blockSize);
+            instance->setRenderPosition(renderStart, sizzleSeed);
+            
+            // The chunk comes out of the instance this much later
+            chunkOffset = warmUpLength + instance->getLatencyInSamples();
+            const auto numSamples = chunkOffset + chunkLength;
+            buffer.setSize(numChannels, numSamples, false, false, true);
+            
+            const auto numToRead = static_cast<int>(juce::jlimit<juce::int64>(0, numSamples, reader->lengthInSamples - renderStart));
+            buffer.clear(numToRead, numSamples - numToRead);
+            
+            if (numToRead > 0 && ! reader->read(&buffer, 0, numToRead, renderStart, true, numChannels > 1)) {
+                instance->releaseResources();
+                return;
+            }
+            
+            juce::MidiBuffer midi;
+            
+            for (int position = 0; position < numSamples && ! threadShouldExit(); position += OfflineRenderer::blockSize) {
+                const auto length = std::min(OfflineRenderer::blockSize, numSamples - position);
+                juce::AudioBuffer<float> block (buffer.getArrayOfWritePointers(), numChannels, position, length);
+                instance->processBlock(block, midi);
+            }
+            
+            instance->releaseResources();
+            succeeded = ! threadShouldExit();
+        }
+        
+        std::unique_ptr<SaunaSizzlerAudioProcessor> instance;
+        std::unique_ptr<juce::AudioFormatReader> reader;
+        const int numChannels;
+        juce::AudioBuffer<float> buffer;
+        const juce::uint64 sizzleSeed;
+        
+        juce::int64 renderStart { 0 };
+        int warmUpLength { 0 };
+        int chunkOffset { 0 };
+        int chunkLength { 0 };
+        bool succeeded { false };
+        
+        JUCE_DECLARE_NON_COPYABLE (ChunkWorker)
+    };
+    
+    int roundUpToBlocks(double numSamples)
+    {
+        const auto numBlocks = static_cast<int>(std::ceil(numSamples / OfflineRenderer::blockSize));
+        return std::max(numBlocks, 0) * OfflineRenderer::blockSize;
+    }
+}
+
+OfflineRenderer::OfflineRenderer(SaunaSizzlerAudioProcessor& processorToRender)
+    : processor(processorToRender)
+{
+}
+
+OfflineRenderer::~OfflineRenderer()
+{
+    pipeline.release();
+}
+
+void OfflineRenderer::render(juce::AudioBuffer<float>& buffer, double sampleRate)
+{
+    const auto numChannels = std::min(buffer.getNumChannels(), 2);
+    
+    if (numChannels == 0 || buffer.getNumSamples() == 0) {
+        return;
+    }
+    
+    prepare(sampleRate);
+    
+    // Silence after the input for the tail and for the latency the
+    // saturator delays everything by, then the output is moved back by it
+    const auto latency = chain.saturatorProcessor.getLatencyInSamples();
+    const auto outputLength = buffer.getNumSamples() + static_cast<int>(getTailSamples(sampleRate));
+    buffer.setSize(buffer.getNumChannels(), outputLength + latency, true, true);
+    
+    pipeline.process(buffer.getArrayOfWritePointers(), numChannels, outputLength + latency);
+    
+    for (int channel = 0; channel < numChannels; channel++) {
+        auto* samples = buffer.getWritePointer(channel);
+        std::copy(samples + latency, samples + latency + outputLength, samples);
+    }
+    
+    buffer.setSize(buffer.getNumChannels(), outputLength, true);
+}
+
+juce::String OfflineRenderer::renderFile(const juce::File& source, const juce::File& destination)
+{
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+    
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor(source));
+    
+    if (reader == nullptr) {
+        return "Cannot read " + source.getFullPathName();
+    }
+    
+    const auto numChannels = static_cast<int>(std::min(reader->numChannels, 2u));
+    
+    if (numChannels == 0) {
+        return source.getFullPathName() + " has no audio channels";
+    }
+    
+    auto writer = createWavWriter(destination, reader->sampleRate, numChannels);
+    
+    if (writer == nullptr) {
+        return "Cannot write " + destination.getFullPathName();
+    }
+    
+    prepare(reader->sampleRate);
+    
+    // The file is followed by silence until the tail is out, all delayed by
+    // the saturator's latency, whose first samples are not written
+    const auto latency = chain.saturatorProcessor.getLatencyInSamples();
+    const auto inputLength = reader->lengthInSamples + getTailSamples(reader->sampleRate) + latency;
+    juce::AudioBuffer<float> buffer (numChannels, segmentSize);
+    
+    for (juce::int64 position = 0; position < inputLength; position += segmentSize) {
+        const auto numSamples = static_cast<int>(std::min<juce::int64>(segmentSize, inputLength - position));
+        const auto numToRead = static_cast<int>(juce::jlimit<juce::int64>(0, numSamples, reader->lengthInSamples - position));
+        buffer.clear(numToRead, numSamples - numToRead);
+        
+        if (numToRead > 0 && ! reader->read(&buffer, 0, numToRead, position, true, numChannels > 1)) {
+            return "Cannot read " + source.getFullPathName();
+        }
+        
+        pipeline.process(buffer.getArrayOfWritePointers(), numChannels, numSamples);
+        
+        const auto numSkipped = static_cast<int>(juce::jlimit<juce::int64>(0, numSamples, latency - position));
+        
+        if (numSkipped < numSamples && ! writer->writeFromAudioSampleBuffer(buffer, numSkipped, numSamples - numSkipped)) {
+            return "Cannot write " + destination.getFullPathName();
+        }
+    }
+    
+    return {};
+}
+
+juce::String OfflineRenderer::renderFileInChunks(const juce::File& source, const juce::File& destination, int numThreads, double chunkSeconds)
+{
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+    
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor(source));
+    
+    if (reader == nullptr) {
+        return "Cannot read " + source.getFullPathName();
+    }
+    
+    const auto numChannels = static_cast<int>(std::min(reader->numChannels, 2u));
+    const auto sampleRate = reader->sampleRate;
+    const auto outputLength = reader->lengthInSamples + getTailSamples(sampleRate);
+    
+    if (numChannels == 0) {
+        return source.getFullPathName() + " has no audio channels";
+    }
+    
+    auto writer = createWavWriter(destination, sampleRate, numChannels);
+    
+    if (writer == nullptr) {
+        return "Cannot write " + destination.getFullPathName();
+    }
+    
+    // The room size is not automated offline, so its tail bounds the warm up
+    juce::Reverb::Parameters reverbParams;
+    reverbParams.roomSize = processor.apvts.getRawParameterValue("REVERB_ROOMSIZE")->load();
+    const auto warmUpSeconds = sauna::ReverbCore<float>::getTailLengthSeconds(reverbParams, warmUpDecayDb);
+    
+    const auto warmUpSamples = roundUpToBlocks(juce::jlimit(0.0, maxTailSeconds, warmUpSeconds) * sampleRate);
+    const auto chunkSamples = std::max(roundUpToBlocks(chunkSeconds * sampleRate), blockSize);
+    const auto numChunks = static_cast<int>((outputLength + chunkSamples - 1) / chunkSamples);
+    const auto numWorkers = juce::jlimit(1, std::max(numChunks, 1), numThreads);
+    
+    juce::MemoryBlock state;
+    processor.getStateInformation(state);
+    
+    std::vector<std::unique_ptr<ChunkWorker>> workers;
+    
+    for (int i = 0; i < numWorkers; i++) {
+        auto instance = std::make_unique<SaunaSizzlerAudioProcessor>();
+        instance->setNonRealtime(true);
+        instance->setStateInformation(state.getData(), static_cast<int>(state.getSize()));
+        instance->setPlayConfigDetails(numChannels, numChannels, sampleRate, blockSize);
+        
+        std::unique_ptr<juce::AudioFormatReader> workerReader (formatManager.createReaderFor(source));
+        
+        if (workerReader == nullptr) {
+            return "Cannot read " + source.getFullPathName();
+        }
+        
+        // The buffers grow by the latency on the first chunk
+        workers.push_back(std::make_unique<ChunkWorker>(std::move(instance), std::move(workerReader), numChannels, warmUpSamples + chunkSamples, processor.getSizzleSeed()));
+    }
+    
+    // Every worker takes a chunk, they are written in order once all are done
+    for (int firstChunk = 0; firstChunk < numChunks; firstChunk += numWorkers) {
+        const auto numInRound = std::min(numWorkers, numChunks - firstChunk);
+        
+        for (int i = 0; i < numInRound; i++) {
+            const auto chunkStart = static_cast<juce::int64>(firstChunk + i) * chunkSamples;
+            const auto chunkLength = static_cast<int>(std::min<juce::int64>(chunkSamples, outputLength - chunkStart));
+            workers[static_cast<size_t>(i)]->startChunk(chunkStart, chunkLength, warmUpSamples);
+        }
+        
+        for (int i = 0; i < numInRound; i++) {
+            auto& worker = *workers[static_cast<size_t>(i)];
+            
+            if (! worker.finishChunk()) {
+                return "Cannot read " + source.getFullPathName();
+            }
+            
+            if (! writer->writeFromAudioSampleBuffer(worker.getBuffer(), worker.getChunkOffset(), worker.getChunkLength())) {
+                return "Cannot write " + destination.getFullPathName();
+            }
+        }
+    }
+    
+    return {};
+}
+
+std::unique_ptr<juce::AudioFormatWriter> OfflineRenderer::createWavWriter(const juce::File& destination, double sampleRate, int numChannels)
+{
+    destination.deleteFile();
+    std::unique_ptr<juce::OutputStream> stream = destination.createOutputStream();
+    
+    if (stream == nullptr) {
+        return {};
+    }
+    
+    juce::WavAudioFormat wavFormat;
+    std::unique_ptr<juce::AudioFormatWriter> writer (wavFormat.createWriterFor(stream.get(),
+                                                                               sampleRate,
+                                                                               static_cast<unsigned int>(numChannels),
+                                                                               24,
+                                                                               {},
+                                                                               0));
+    
+    // The writer owns the stream from here on
+    if (writer != nullptr) {
+        stream.release();
+    }
+    
+    return writer;
+}
+
+juce::int64 OfflineRenderer::getTailSamples(double sampleRate) const
+{
+    const auto tailSeconds = juce::jlimit(0.0, maxTailSeconds, processor.getTailLengthSeconds());
+    return static_cast<juce::int64>(std::ceil(tailSeconds * sampleRate));
+}
+
+// Every render starts from silence with the parameters as they are now
+void OfflineRenderer::prepare(double sampleRate)
+{
+    processor.prepareOfflineChain(chain, sampleRate, blockSize);
+    
+    if (! pipelinePrepared) {
+        pipeline.prepare(blockSize);
+        pipelinePrepared = true;
+    }
+}
@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../PluginProcessor.h"
+
+// Renders audio through the exciter away from the host, e.g. to batch
+// process files, with the parameters and custom curve of a plugin instance
+// at Offline quality. It has its own chain, so the instance can keep playing.
+// renderFile() runs each stage of the chain on its own thread (see
+// sauna::ExciterPipeline), renderFileInChunks() runs whole instances of the
+// plugin on parts of the file. All of them line the output up with the
+// input, the saturator's latency is dropped from the start, and run on past
+// the end of the input until the reverb tail the plugin reports has died
+// out. Message thread only, every call blocks until the audio is rendered.
+class OfflineRenderer
+{
+public:
+    explicit OfflineRenderer(SaunaSizzlerAudioProcessor& processorToRender);
+    ~OfflineRenderer();
+
+    // Renders the first one or two channels in place, the buffer grows by
+    // the length of the tail
+    void render(juce::AudioBuffer<float>& buffer, double sampleRate);
+
+    // Streams a file of any length through the exciter and writes it, with
+    // its tail, as a 24 bit WAV. Returns an error message, empty on success.
+    juce::String renderFile(const juce::File& source, const juce::File& destination);
+
+    // Splits a file into chunks that independent instances of the plugin,
+    // restored from the state of this one, render in parallel. Every chunk
+    // starts early by the time the reverb takes to fall warmUpDecayDb, and
+    // its steam noise and LFO are lined up with its place in the file, so
+    // the chunks join seamlessly and the result stays within -90 dBFS of
+    // renderFile(). The tail is cut into chunks like the file. Holds
+    // numThreads chunks plus their warm up in memory.
+    juce::String renderFileInChunks(const juce::File& source,
+                                    const juce::File& destination,
+                                    int numThreads = juce::SystemStats::getNumCpus(),
+                                    double chunkSeconds = 30.0);
+
+    // Size of the blocks handed from stage to stage, and to the instances
+    // rendering chunks. Chunks start on a block boundary so every instance
+    // processes the same blocks a single one would.
+    static constexpr int blockSize = 1024;
+
+    // Decay of the reverb tail before a chunk starts, its state is then far
+    // enough below the signal that the join cannot be heard
+    static constexpr double warmUpDecayDb = 96.0;
+
+    // Longest reverb tail and warm up rendered
+    static constexpr double maxTailSeconds = 60.0;
+
+private:
+    void prepare(double sampleRate);
+
+    // Samples rendered after the end of the input, getTailLengthSeconds()
+    // of the plugin
+    juce::int64 getTailSamples(double sampleRate) const;
+
+    static std::unique_ptr<juce::AudioFormatWriter> createWavWriter(const juce::File& destination,
+                                                                    double sampleRate,
+                                                                    int numChannels);
+
+    // Samples read from a file per pipeline call
+    static constexpr int segmentSize = 1 << 16;
+
+    SaunaSizzlerAudioProcessor& processor;
+    sauna::ExciterChain<float> chain;
+    sauna::ExciterPipeline<float> pipeline { chain };
+    bool pipelinePrepared { false };
+
+    JUCE_DECLARE_NON_COPYABLE (OfflineRenderer)
+};
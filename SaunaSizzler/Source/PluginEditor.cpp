@@ -36,6 +36,13 @@ SaunaSizzlerAudioProcessorEditor::SaunaSizzlerAudioProcessorEditor (SaunaSizzler
     addAndMakeVisible(footer);
     
     addAndMakeVisible(magicButton);
+    
+    // DSP load readout, refreshed from a timer
+    dspLoadLabel.setJustificationType(juce::Justification::centredLeft);
+    dspLoadLabel.setColour(juce::Label::textColourId, juce::Colours::white);
+    dspLoadLabel.setInterceptsMouseClicks(false, false);
+    addAndMakeVisible(dspLoadLabel);
+    
     setSize (720, 405);
     
     magicButton.addListener(this);
@@ -54,6 +61,8 @@ SaunaSizzlerAudioProcessorEditor::SaunaSizzlerAudioProcessorEditor (SaunaSizzler
     
     lfoRateSliderAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts,
                                                                                                      "LFO_RATE", bigBoyDial);
+    
+    startTimerHz(10);
 }
 
 SaunaSizzlerAudioProcessorEditor::~SaunaSizzlerAudioProcessorEditor()
@@ -102,6 +111,8 @@ void SaunaSizzlerAudioProcessorEditor::resized()
     
     magicButton.setSize(150, 50);
     updateUIMode();
+    
+    dspLoadLabel.setBounds(8, 4, 360, 20);
 }
 
 void SaunaSizzlerAudioProcessorEditor::updateUIMode()
@@ -125,6 +136,19 @@ void SaunaSizzlerAudioProcessorEditor::updateUIMode()
     }
 }
 
+void SaunaSizzlerAudioProcessorEditor::timerCallback()
+{
+    const auto load = audioProcessor.getDspLoad();
+    
+    juce::String text;
+    text << "DSP " << juce::String(load.current * 100.0, 1) << "%"
+         << "  avg " << juce::String(load.average * 100.0, 1) << "%"
+         << "  peak " << juce::String(load.peak * 100.0, 1) << "%"
+         << "  overruns " << load.overruns;
+    
+    dspLoadLabel.setText(text, juce::dontSendNotification);
+}
+
 void SaunaSizzlerAudioProcessorEditor::buttonClicked (juce::Button* button)
 {
     if (button == &magicButton) {
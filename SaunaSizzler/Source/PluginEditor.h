@@ -18,6 +18,7 @@
 */
 class SaunaSizzlerAudioProcessorEditor  : public juce::AudioProcessorEditor
                                         , public juce::Button::Listener
+                                        , private juce::Timer
 {
 public:
     SaunaSizzlerAudioProcessorEditor (SaunaSizzlerAudioProcessor&);
@@ -31,6 +32,7 @@ public:
 
 private:
     void updateUIMode();
+    void timerCallback() override;
     
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
@@ -50,6 +52,8 @@ private:
     
     bool advancedModeEnabled { false };
     
+    juce::Label dspLoadLabel;
+    
     // Attachments
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> saturatorPreGainDecibelsSliderAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> saturatorSaturationTypeSliderAttachment;
@@ -23,10 +23,56 @@ SaunaSizzlerAudioProcessor::SaunaSizzlerAudioProcessor()
 #endif
 : apvts(*this, nullptr, "params", createParameters())
 {
+    // Saturation type changes are handed to the audio thread as they happen
+    apvts.addParameterListener("SATURATOR_TYPE", this);
+    
+    // The parameter IDs are looked up once here rather than on the audio thread
+    preGainParameter = apvts.getRawParameterValue("SATURATOR_PREGAINDB");
+    saturatorTypeParameter = apvts.getRawParameterValue("SATURATOR_TYPE");
+    numBandsParameter = apvts.getRawParameterValue("MULTIBAND_BANDS");
+    crossoverParameters[0] = apvts.getRawParameterValue("CROSSOVER_LOW");
+    crossoverParameters[1] = apvts.getRawParameterValue("CROSSOVER_MID");
+    crossoverParameters[2] = apvts.getRawParameterValue("CROSSOVER_HIGH");
+    steamerGainParameter = apvts.getRawParameterValue("STEAMER_GAINDB");
+    sizzleDensityParameter = apvts.getRawParameterValue("SIZZLE_DENSITY");
+    sizzleGainParameter = apvts.getRawParameterValue("SIZZLE_GAINDB");
+    roomSizeParameter = apvts.getRawParameterValue("REVERB_ROOMSIZE");
+    stageOrderParameter = apvts.getRawParameterValue("STAGE_ORDER");
+    lfoRateParameter = apvts.getRawParameterValue("LFO_RATE");
+    qualityTierParameter = apvts.getRawParameterValue("QUALITY_TIER");
+    
+    // In the order of sauna::ModulationSource and sauna::ModulationDestination
+    const char* sourceIds[] = { "LFO", "ENV" };
+    const char* destinationIds[] = { "PREGAIN", "STEAM", "ROOMSIZE", "SIZZLE" };
+    
+    for (int source = 0; source < sauna::numModulationSources; source++) {
+        for (int destination = 0; destination < sauna::numModulationDestinations; destination++) {
+            const auto parameterID = juce::String("MOD_") + sourceIds[source] + "_" + destinationIds[destination];
+            modulationDepthParameters[source][destination] = apvts.getRawParameterValue(parameterID);
+        }
+    }
+    
+    for (int band = 0; band < sauna::maxMultibandBands; band++) {
+        const auto prefix = juce::String("BAND") + juce::String(band + 1);
+        bandDriveParameters[band] = apvts.getRawParameterValue(prefix + "_DRIVEDB");
+        bandTypeParameters[band] = apvts.getRawParameterValue(prefix + "_TYPE");
+    }
+    
+    floatChain.steamerProcessor.sizzle.setSeed(sizzleSeed);
+    doubleChain.steamerProcessor.sizzle.setSeed(sizzleSeed);
+    
+    // Runs on the compiler thread, the saturators swap the tables in
+    curveCompiler.onCurveCompiled = [this] (const sauna::CompiledCurve& curve) {
+        floatChain.saturatorProcessor.saturator.setCustomCurve(std::make_unique<sauna::CurveTable<float>>(curve));
+        doubleChain.saturatorProcessor.saturator.setCustomCurve(std::make_unique<sauna::CurveTable<double>>(curve));
+        floatChain.saturatorProcessor.multiband.setCustomCurve(curve);
+        doubleChain.saturatorProcessor.multiband.setCustomCurve(curve);
+    };
 }
 
 SaunaSizzlerAudioProcessor::~SaunaSizzlerAudioProcessor()
 {
+    apvts.removeParameterListener("SATURATOR_TYPE", this);
 }
 
 //==============================================================================
@@ -62,9 +108,12 @@ bool SaunaSizzlerAudioProcessor::isMidiEffect() const
    #endif
 }
 
+// Time the reverb takes to fall 60 dB at the current room size
 double SaunaSizzlerAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    juce::Reverb::Parameters reverbParams;
+    reverbParams.roomSize = roomSizeParameter->load();
+    return sauna::ReverbCore<float>::getTailLengthSeconds(reverbParams);
 }
 
 int SaunaSizzlerAudioProcessor::getNumPrograms()
@@ -93,26 +142,79 @@ void SaunaSizzlerAudioProcessor::changeProgramName (int index, const juce::Strin
 
 //==============================================================================
 void SaunaSizzlerAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
+{
+    // Tier settings are applied first so the processors start on them
+    applyQualityTier(getRequestedQualityTier());
+    
+    // Curves set before the first prepare, including the default one, are
+    // only compiled once they can be heard. A bounce needs the curve from
+    // its first sample, so it compiles here with the compiler thread stopped.
+    prepared = true;
+    
+    if (curveCompilePending.exchange(false)) {
+        if (! isNonRealtime()) {
+            curveCompiler.compile(customCurve);
+        } else {
+            curveCompiler.compileNow(customCurve);
+        }
+    }
+    
+    // Prepare processors
+    if (isUsingDoublePrecision()) {
+        prepareChain(doubleChain, sampleRate, samplesPerBlock);
+        setLatencySamples(doubleChain.saturatorProcessor.getLatencyInSamples());
+    } else {
+        prepareChain(floatChain, sampleRate, samplesPerBlock);
+        setLatencySamples(floatChain.saturatorProcessor.getLatencyInSamples());
+    }
+    
+    // Load measurement
+    loadMeasurer.reset(sampleRate, samplesPerBlock);
+    currentLoad = 0.0;
+    peakLoad = 0.0;
+    
+   #if SAUNA_ENABLE_PROFILING
+    // Only the histogram is kept all the time, traces are started on request
+    if (profileExporter == nullptr)
+    {
+        profileExporter = std::make_unique<sauna::StageProfileExporter>(profiler);
+        profileExporter->start();
+    }
+   #endif
+}
+
+template <typename SampleType>
+void SaunaSizzlerAudioProcessor::prepareChain(sauna::ExciterChain<SampleType>& chain, double sampleRate, int samplesPerBlock)
 {
     // Testing Params
     juce::Reverb::Parameters reverbParams{0.5f, 0.5f, 0.5f, 0.4f, 1.0f, 0.0f};
-    steamerReverb.setParameters(reverbParams);
+    chain.steamerReverb.setParameters(reverbParams);
     
-    // LFO Initilization
-    phaseState[0] = 0.f;
-    phaseState[1] = static_cast<float>(M_PI / 2.0);
-    phaseInc = static_cast<float>(2.0 * M_PI / sampleRate) * modRate;
+    // Start on the current type, prepare skips the crossfade
+    chain.saturatorProcessor.saturator.setSaturation(static_cast<sauna::SaturationType>(static_cast<int>(saturatorTypeParameter->load())));
+    chain.saturatorProcessor.multiband.setNumBands(static_cast<int>(numBandsParameter->load()));
     
-    // Prepare processors
-    steamerReverb.setSampleRate(sampleRate);
-    steamerReverb.reset();
-    steamer.prepare();
+    for (int band = 0; band < sauna::maxMultibandBands; band++) {
+        chain.saturatorProcessor.multiband.setBandSaturation(band, static_cast<sauna::SaturationType>(static_cast<int>(bandTypeParameters[band]->load())));
+    }
+    
+    juce::dsp::ProcessSpec spec;
+    spec.sampleRate = sampleRate;
+    spec.maximumBlockSize = static_cast<juce::uint32>(samplesPerBlock);
+    spec.numChannels = 2;
+    
+    chain.prepare(spec);
+    
+   #if SAUNA_ENABLE_PROFILING
+    chain.setProfiler(&profiler);
+   #endif
 }
 
 void SaunaSizzlerAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    prepared = false;
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -143,61 +245,54 @@ bool SaunaSizzlerAudioProcessor::isBusesLayoutSupported (const BusesLayout& layo
 
 void SaunaSizzlerAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
-    
     //audio buffer has the input that should be replaced by the output
-    
+    processSamples(buffer, floatChain);
+}
+
+void SaunaSizzlerAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processSamples(buffer, doubleChain);
+}
+
+bool SaunaSizzlerAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+    return true;
+}
+
+template <typename SampleType>
+void SaunaSizzlerAudioProcessor::processSamples(juce::AudioBuffer<SampleType>& buffer, sauna::ExciterChain<SampleType>& chain)
+{
     juce::ScopedNoDenormals noDenormals;
     
-   // Update parameters
-   auto saturatorPreGainDecibels = apvts.getRawParameterValue("SATURATOR_PREGAINDB");
-   // auto& saturatorBlock = chain.get<0>();
-   saturator.setPreGain(saturatorPreGainDecibels->load());
-   
-   auto saturatorType = apvts.getRawParameterValue("SATURATOR_TYPE");
-   saturator.setSaturation(static_cast<sauna::Saturator::SaturationType>(saturatorType->load()));
-    
-    auto steamerGainDecibels = apvts.getRawParameterValue("STEAMER_GAINDB");
-    steamer.setGain(steamerGainDecibels->load());
-    
-    auto reverbRoomSize = apvts.getRawParameterValue("REVERB_ROOMSIZE");
-    auto steamerReverbParams = steamerReverb.getParameters();
-    steamerReverbParams.roomSize = reverbRoomSize->load();
-    steamerReverb.setParameters(steamerReverbParams);
-    
-    auto lfoRate = apvts.getRawParameterValue("LFO_RATE");
-    updatePhaseIncrement(lfoRate->load());
-    
-    // LFO MOD
-    float lfo[2] { 0.f, 0.f };
-    lfo[0] = 0.5f + 0.5f * std::sin(phaseState[0]);
-    lfo[1] = 0.5f + 0.5f * std::sin(phaseState[1]);
-
-    // Increment and wrap phase states
-    phaseState[0] = std::fmod(phaseState[0] + phaseInc, static_cast<float>(2 * M_PI));
-    phaseState[1] = std::fmod(phaseState[1] + phaseInc, static_cast<float>(2 * M_PI));
-    
-    // Process single samples through each processor
-    // Audio buffer has the input that should be replaced by the output
-    for (int i = 0; i < buffer.getNumSamples(); i++){
-        // We process in place, so we only need 1 sample frame of write pointers
-        auto write = buffer.getArrayOfWritePointers();
-        float* writeSampleArrayLeft = write[0];
-        float* writeSampleArrayRight = write[1];
-        float* x[2] {writeSampleArrayLeft, writeSampleArrayRight};
-        x[0] = writeSampleArrayLeft;
-        x[1] = writeSampleArrayRight;
-        
-        int left = 0;
-        int right = 1;
-        if (buffer.getNumChannels() == 1) {
-            right = 0;
-        }
-        
-        
-        steamer.process(&(x[left][i]), &(x[right][i]), lfo, buffer.getNumChannels(), 1);
-        steamerReverb.process(&(x[left][i]), &(x[right][i]), lfo, buffer.getNumChannels(), 1);
-        saturator.process(&(x[left][i]), &(x[right][i]), lfo, buffer.getNumChannels(), 1);
+    const auto blockStartMs = juce::Time::getMillisecondCounterHiRes();
+    
+   #if SAUNA_ENABLE_PROFILING
+    profiler.beginBlock(buffer.getNumSamples(), getSampleRate());
+   #endif
+    
+    {
+        SAUNA_PROFILE_STAGE(profiler, sauna::ProfileStage::ParameterUpdate);
+        updateParameters(chain);
     }
+    
+    // Tier switches are crossfaded by the processors themselves
+    const auto requestedTier = getRequestedQualityTier();
+    if (requestedTier != activeQualityTier.load()) {
+        applyQualityTier(requestedTier);
+    }
+    
+    // Audio buffer has the input that should be replaced by the output, the
+    // chain times its own stages
+    const auto numChannels = static_cast<size_t>(std::min(buffer.getNumChannels(), 2));
+    auto block = juce::dsp::AudioBlock<SampleType>(buffer).getSubsetChannelBlock(0, numChannels);
+    
+    chain.process(juce::dsp::ProcessContextReplacing<SampleType>(block));
+    
+   #if SAUNA_ENABLE_PROFILING
+    profiler.endBlock();
+   #endif
+    
+    updateDspLoad(juce::Time::getMillisecondCounterHiRes() - blockStartMs, buffer.getNumSamples());
 }
 
 //==============================================================================
@@ -214,17 +309,109 @@ juce::AudioProcessorEditor* SaunaSizzlerAudioProcessor::createEditor()
 //==============================================================================
 void SaunaSizzlerAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    // Parameters plus the custom curve
+    auto xml = apvts.copyState().createXml();
+    
+    if (xml == nullptr) {
+        return;
+    }
+    
+    xml->addChildElement(customCurve.createXml().release());
+    copyXmlToBinary(*xml, destData);
 }
 
 void SaunaSizzlerAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    auto xml = getXmlFromBinary(data, sizeInBytes);
+    
+    if (xml == nullptr || ! xml->hasTagName(apvts.state.getType())) {
+        return;
+    }
+    
+    if (auto* curveXml = xml->getChildByName("TRANSFER_CURVE")) {
+        setCustomCurve(sauna::TransferCurve::fromXml(*curveXml));
+        xml->removeChildElement(curveXml, true);
+    }
+    
+    apvts.replaceState(juce::ValueTree::fromXml(*xml));
+}
+
+void SaunaSizzlerAudioProcessor::setCustomCurve(const sauna::TransferCurve& curve)
+{
+    customCurve = curve;
+    
+    // Hosts restore the state of every instance when a session loads, the
+    // compiler thread is only started once the instance is prepared
+    if (prepared) {
+        curveCompiler.compile(customCurve);
+    } else {
+        curveCompilePending = true;
+    }
+}
+
+const sauna::TransferCurve& SaunaSizzlerAudioProcessor::getCustomCurve() const noexcept
+{
+    return customCurve;
+}
+
+juce::String SaunaSizzlerAudioProcessor::getCustomCurveError() const
+{
+    return curveCompiler.getLastError();
+}
+
+void SaunaSizzlerAudioProcessor::prepareOfflineChain(sauna::ExciterChain<float>& chain, double sampleRate, int maximumBlockSize)
+{
+    applyQualitySettings(chain, sauna::getQualitySettings(sauna::QualityTier::Offline));
+    prepareChain(chain, sampleRate, maximumBlockSize);
+    chain.steamerProcessor.sizzle.setSeed(sizzleSeed);
+    
+   #if SAUNA_ENABLE_PROFILING
+    // The profiler belongs to the audio thread of this instance
+    chain.setProfiler(nullptr);
+   #endif
+    
+    sauna::CompiledCurve compiled;
+    juce::String error;
+    
+    if (sauna::TransferCurveCompiler::compileCurve(customCurve, compiled, error)) {
+        chain.saturatorProcessor.saturator.setCustomCurve(std::make_unique<sauna::CurveTable<float>>(compiled));
+        chain.saturatorProcessor.multiband.setCustomCurve(compiled);
+    }
+    
+    updateParameters(chain);
+}
+
+void SaunaSizzlerAudioProcessor::setRenderPosition(juce::int64 samplePosition, juce::uint64 sizzleSeedToUse)
+{
+    const auto numChannels = std::min(getMainBusNumOutputChannels(), 2);
+    floatChain.setPosition(samplePosition, numChannels, sizzleSeedToUse);
+    doubleChain.setPosition(samplePosition, numChannels, sizzleSeedToUse);
+}
+
+#if SAUNA_ENABLE_PROFILING
+juce::String SaunaSizzlerAudioProcessor::getProfileSummary() const
+{
+    return profileExporter != nullptr ? profileExporter->getSummary() : juce::String();
 }
 
+bool SaunaSizzlerAudioProcessor::startProfileTrace(const juce::File& traceFile, double maxSeconds)
+{
+    return profileExporter != nullptr && profileExporter->startTrace(traceFile, maxSeconds);
+}
+
+void SaunaSizzlerAudioProcessor::stopProfileTrace()
+{
+    if (profileExporter != nullptr) {
+        profileExporter->stopTrace();
+    }
+}
+
+juce::File SaunaSizzlerAudioProcessor::getProfileTraceFile() const
+{
+    return profileExporter != nullptr ? profileExporter->getTraceFile() : juce::File();
+}
+#endif
+
 //==============================================================================
 // This creates new instances of the plugin..
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
@@ -232,9 +419,141 @@ juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
     return new SaunaSizzlerAudioProcessor();
 }
 
-void SaunaSizzlerAudioProcessor::updatePhaseIncrement(float modRate) {
-    double sampleRate = getSampleRate();
-    phaseInc = static_cast<float>(2.0 * M_PI / sampleRate) * modRate;
+template <typename SampleType>
+void SaunaSizzlerAudioProcessor::updateParameters(sauna::ExciterChain<SampleType>& chain)
+{
+    // Update parameters
+    const auto saturatorPreGainDecibels = preGainParameter->load();
+    // auto& saturatorBlock = chain.get<0>();
+    chain.saturatorProcessor.saturator.setPreGain(saturatorPreGainDecibels);
+    chain.saturatorProcessor.multiband.setPreGain(saturatorPreGainDecibels);
+    
+    // Multiband saturation, one band turns it off
+    auto& multiband = chain.saturatorProcessor.multiband;
+    multiband.setNumBands(static_cast<int>(numBandsParameter->load()));
+    
+    for (int crossover = 0; crossover < sauna::maxMultibandBands - 1; crossover++) {
+        multiband.setCrossoverFrequency(crossover, crossoverParameters[crossover]->load());
+    }
+    
+    for (int band = 0; band < sauna::maxMultibandBands; band++) {
+        multiband.setBandDrive(band, bandDriveParameters[band]->load());
+        multiband.setBandSaturation(band, static_cast<sauna::SaturationType>(static_cast<int>(bandTypeParameters[band]->load())));
+    }
+    
+    const auto steamerGainDecibels = steamerGainParameter->load();
+    chain.steamerProcessor.steamer.setGain(steamerGainDecibels);
+    
+    chain.steamerProcessor.sizzle.setDensity(sizzleDensityParameter->load());
+    chain.steamerProcessor.sizzle.setGain(sizzleGainParameter->load());
+    
+    // The chain passes the modulated room size to the reverb
+    const auto reverbRoomSize = roomSizeParameter->load();
+    chain.setRoomSize(reverbRoomSize);
+    
+    chain.setStageOrder(static_cast<sauna::StageOrder>(static_cast<int>(stageOrderParameter->load())));
+    
+    // Modulation matrix
+    const auto lfoRate = lfoRateParameter->load();
+    chain.modulation.setLfoRate(lfoRate);
+    
+    for (int source = 0; source < sauna::numModulationSources; source++) {
+        for (int destination = 0; destination < sauna::numModulationDestinations; destination++) {
+            chain.modulation.setDepth(static_cast<sauna::ModulationSource>(source),
+                                      static_cast<sauna::ModulationDestination>(destination),
+                                      modulationDepthParameters[source][destination]->load());
+        }
+    }
+    
+   #if SAUNA_ENABLE_PROFILING
+    profiler.setParameters({ saturatorPreGainDecibels,
+                             static_cast<int>(saturatorTypeParameter->load()),
+                             steamerGainDecibels,
+                             reverbRoomSize,
+                             lfoRate });
+   #endif
+}
+
+// Can be called from the message thread or the audio thread, setSaturation
+// only stores the request and the saturator crossfades to it
+void SaunaSizzlerAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
+{
+    if (parameterID == "SATURATOR_TYPE") {
+        const auto type = static_cast<sauna::SaturationType>(static_cast<int>(newValue));
+        floatChain.saturatorProcessor.saturator.setSaturation(type);
+        doubleChain.saturatorProcessor.saturator.setSaturation(type);
+    }
+}
+
+void SaunaSizzlerAudioProcessor::updateDspLoad(double millisecondsTaken, int numSamples)
+{
+    const auto sampleRate = getSampleRate();
+    
+    if (sampleRate <= 0.0 || numSamples <= 0) {
+        return;
+    }
+    
+    loadMeasurer.registerRenderTime(millisecondsTaken, numSamples);
+    
+    const auto budgetMs = 1000.0 * numSamples / sampleRate;
+    const auto load = millisecondsTaken / budgetMs;
+    
+    currentLoad = load;
+    
+    if (load > peakLoad.load()) {
+        peakLoad = load;
+    }
+}
+
+sauna::QualityTier SaunaSizzlerAudioProcessor::getQualityTier() const noexcept
+{
+    return activeQualityTier.load();
+}
+
+sauna::QualityTier SaunaSizzlerAudioProcessor::getRequestedQualityTier() const
+{
+    // Bounces always get the best quality
+    if (isNonRealtime()) {
+        return sauna::QualityTier::Offline;
+    }
+    
+    return static_cast<sauna::QualityTier>(static_cast<int>(qualityTierParameter->load()));
+}
+
+// Only changes targets, nothing here allocates
+void SaunaSizzlerAudioProcessor::applyQualityTier(sauna::QualityTier tier)
+{
+    const auto settings = sauna::getQualitySettings(tier);
+    
+    applyQualitySettings(floatChain, settings);
+    applyQualitySettings(doubleChain, settings);
+    
+    activeQualityTier = tier;
+}
+
+template <typename SampleType>
+void SaunaSizzlerAudioProcessor::applyQualitySettings(sauna::ExciterChain<SampleType>& chain, const sauna::QualitySettings& settings)
+{
+    chain.saturatorProcessor.setOversamplingOrder(settings.oversamplingOrder);
+    chain.saturatorProcessor.saturator.setPrecision(settings.saturatorPrecision);
+    chain.saturatorProcessor.multiband.setPrecision(settings.saturatorPrecision);
+    chain.steamerReverb.setRateDivisor(settings.reverbRateDivisor);
+    chain.steamerProcessor.sizzle.setMaxGrains(settings.maxSizzleGrains);
+}
+
+SaunaSizzlerAudioProcessor::DspLoad SaunaSizzlerAudioProcessor::getDspLoad() const noexcept
+{
+    DspLoad load;
+    load.current = currentLoad.load();
+    load.average = loadMeasurer.getLoadAsProportion();
+    load.peak = peakLoad.load();
+    load.overruns = loadMeasurer.getXRunCount();
+    return load;
+}
+
+void SaunaSizzlerAudioProcessor::resetPeakDspLoad() noexcept
+{
+    peakLoad = 0.0;
 }
 
 juce::AudioProcessorValueTreeState::ParameterLayout SaunaSizzlerAudioProcessor::createParameters()
@@ -255,17 +574,64 @@ juce::AudioProcessorValueTreeState::ParameterLayout SaunaSizzlerAudioProcessor::
     saturatorTypes.add("HardClipping");
     saturatorTypes.add("SoftClipping");
     saturatorTypes.add("Tube");
+    saturatorTypes.add("Custom");
     params.add(std::make_unique<juce::AudioParameterChoice>("SATURATOR_TYPE",
                                                             "Saturator Type",
                                                             saturatorTypes,
                                                             4));
     
+    // Multiband saturation, 1 band is the full band saturator
+    params.add(std::make_unique<juce::AudioParameterInt>("MULTIBAND_BANDS",
+                                                         "Bands",
+                                                         1,
+                                                         sauna::maxMultibandBands,
+                                                         1));
+    
+    const auto addCrossover = [&params] (const char* parameterID, const char* name, float defaultValue) {
+        params.add(std::make_unique<juce::AudioParameterFloat>(parameterID,
+                                                               name,
+                                                               juce::NormalisableRange<float>(20.0f, 20000.0f, 1.0f, 0.25f),
+                                                               defaultValue));
+    };
+    
+    addCrossover("CROSSOVER_LOW", "Crossover Low", 150.0f);
+    addCrossover("CROSSOVER_MID", "Crossover Mid", 1500.0f);
+    addCrossover("CROSSOVER_HIGH", "Crossover High", 6000.0f);
+    
+    // Drive on top of the pre gain and saturation type of each band
+    for (int band = 1; band <= sauna::maxMultibandBands; band++) {
+        const auto prefix = juce::String("BAND") + juce::String(band);
+        const auto name = juce::String("Band ") + juce::String(band);
+        
+        params.add(std::make_unique<juce::AudioParameterFloat>(prefix + "_DRIVEDB",
+                                                               name + " Drive dB",
+                                                               -12.0f,
+                                                               12.0f,
+                                                               0.0f));
+        params.add(std::make_unique<juce::AudioParameterChoice>(prefix + "_TYPE",
+                                                                name + " Type",
+                                                                saturatorTypes,
+                                                                4));
+    }
+    
     // Steamer gain
     params.add(std::make_unique<juce::AudioParameterFloat>("STEAMER_GAINDB",
                                                            "Steamer Gain dB",
                                                            juce::NormalisableRange<float>(-70.0f, 0.0f, 0.5f, 1.5f),
                                                            -70.0f));
     
+    // Sizzle grains per second, off by default
+    params.add(std::make_unique<juce::AudioParameterFloat>("SIZZLE_DENSITY",
+                                                           "Sizzle Density",
+                                                           juce::NormalisableRange<float>(0.0f, 2000.0f, 1.0f, 0.3f),
+                                                           0.0f));
+    
+    // Sizzle gain
+    params.add(std::make_unique<juce::AudioParameterFloat>("SIZZLE_GAINDB",
+                                                           "Sizzle Gain dB",
+                                                           juce::NormalisableRange<float>(-70.0f, 0.0f, 0.5f, 1.5f),
+                                                           -18.0f));
+    
     // Reverb room size
     params.add(std::make_unique<juce::AudioParameterFloat>("REVERB_ROOMSIZE",
                                                            "Reverb Room Size",
@@ -280,5 +646,39 @@ juce::AudioProcessorValueTreeState::ParameterLayout SaunaSizzlerAudioProcessor::
                                                            1000.0f,
                                                            100.0f));
     
+    // Modulation depths, the LFO drives the steam by default
+    const auto addDepth = [&params] (const char* parameterID, const char* name, float defaultValue) {
+        params.add(std::make_unique<juce::AudioParameterFloat>(parameterID, name, 0.0f, 1.0f, defaultValue));
+    };
+    
+    addDepth("MOD_LFO_PREGAIN", "LFO > PreGain", 0.0f);
+    addDepth("MOD_LFO_STEAM", "LFO > Steam", 1.0f);
+    addDepth("MOD_LFO_ROOMSIZE", "LFO > Room Size", 0.0f);
+    addDepth("MOD_LFO_SIZZLE", "LFO > Sizzle", 0.5f);
+    addDepth("MOD_ENV_PREGAIN", "Envelope > PreGain", 0.0f);
+    addDepth("MOD_ENV_STEAM", "Envelope > Steam", 0.0f);
+    addDepth("MOD_ENV_ROOMSIZE", "Envelope > Room Size", 0.0f);
+    addDepth("MOD_ENV_SIZZLE", "Envelope > Sizzle", 1.0f);
+    
+    // Quality tier, Offline is also selected automatically while bouncing
+    juce::StringArray qualityTiers;
+    qualityTiers.add("Eco");
+    qualityTiers.add("Realtime");
+    qualityTiers.add("Offline");
+    params.add(std::make_unique<juce::AudioParameterChoice>("QUALITY_TIER",
+                                                            "Quality",
+                                                            qualityTiers,
+                                                            1));
+    
+    // Stage order, in the order of sauna::StageOrder
+    juce::StringArray stageOrders;
+    for (int i = 0; i < sauna::numStageOrders; i++) {
+        stageOrders.add(sauna::getStageOrderName(static_cast<sauna::StageOrder>(i)));
+    }
+    params.add(std::make_unique<juce::AudioParameterChoice>("STAGE_ORDER",
+                                                            "Stage Order",
+                                                            stageOrders,
+                                                            0));
+    
     return params;
 }
@@ -19,6 +19,7 @@ class SaunaSizzlerAudioProcessor  : public juce::AudioProcessor
                             #if JucePlugin_Enable_ARA
                              , public juce::AudioProcessorARAExtension
                             #endif
+                                  , private juce::AudioProcessorValueTreeState::Listener
 {
 public:
     //==============================================================================
@@ -34,6 +35,8 @@ public:
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -57,9 +60,55 @@ public:
     //==============================================================================
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
-    void updatePhaseIncrement (float modRate);
     
     juce::AudioProcessorValueTreeState apvts;
+    
+    // DSP load of this instance as a proportion of the real-time budget of a
+    // block (1.0 means the block took as long as it lasts)
+    struct DspLoad
+    {
+        double current { 0.0 };
+        double average { 0.0 };
+        double peak { 0.0 };
+        int overruns { 0 };
+    };
+    
+    DspLoad getDspLoad() const noexcept;
+    void resetPeakDspLoad() noexcept;
+    
+    // Tier currently rendering, Offline whenever the host bounces
+    sauna::QualityTier getQualityTier() const noexcept;
+    
+    // Curve used by the Custom saturation type, compiled in the background
+    // and saved with the plugin state. Message thread only.
+    void setCustomCurve(const sauna::TransferCurve& curve);
+    const sauna::TransferCurve& getCustomCurve() const noexcept;
+    juce::String getCustomCurveError() const;
+    
+    // Sets up a chain of the caller's own with the current parameters and
+    // custom curve at Offline quality, for rendering away from the host.
+    // Message thread only, the curve is compiled before it returns.
+    void prepareOfflineChain(sauna::ExciterChain<float>& chain, double sampleRate, int maximumBlockSize);
+    
+    // Lines the steam noise, the LFO and the sizzle of a freshly prepared
+    // instance up with a render that started samplePosition samples earlier
+    // with the given sizzle seed, so several instances can render parts of
+    // one file. Call it after prepareToPlay.
+    void setRenderPosition(juce::int64 samplePosition, juce::uint64 sizzleSeedToUse);
+    
+    // Picked at random per instance so instances do not sizzle in lockstep
+    juce::uint64 getSizzleSeed() const noexcept { return sizzleSeed; }
+
+   #if SAUNA_ENABLE_PROFILING
+    // Histogram of the stage timings collected since the first prepareToPlay
+    juce::String getProfileSummary() const;
+    
+    // Streams every block from now on to a trace file, until stopProfileTrace()
+    // or maxSeconds of audio. Only works once the instance is prepared.
+    bool startProfileTrace(const juce::File& traceFile, double maxSeconds = 60.0);
+    void stopProfileTrace();
+    juce::File getProfileTraceFile() const;
+   #endif
 
 private:
     enum ProcessorIndex
@@ -70,15 +119,68 @@ private:
     };
     
     juce::AudioProcessorValueTreeState::ParameterLayout createParameters();
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
     
-    sauna::Saturator saturator;
-    sauna::SteamerReverb steamerReverb;
-    sauna::Steamer steamer;
-
-    // LFO states
-    float phaseState[2] { 0.f, 0.f };
-    float phaseInc { 0.f };
-    float modRate { 100.0f };
+    template <typename SampleType>
+    void prepareChain(sauna::ExciterChain<SampleType>& chain, double sampleRate, int samplesPerBlock);
+    
+    template <typename SampleType>
+    void processSamples(juce::AudioBuffer<SampleType>& buffer, sauna::ExciterChain<SampleType>& chain);
+    
+    template <typename SampleType>
+    void updateParameters(sauna::ExciterChain<SampleType>& chain);
+    
+    void updateDspLoad(double millisecondsTaken, int numSamples);
+    sauna::QualityTier getRequestedQualityTier() const;
+    void applyQualityTier(sauna::QualityTier tier);
+    
+    template <typename SampleType>
+    static void applyQualitySettings(sauna::ExciterChain<SampleType>& chain, const sauna::QualitySettings& settings);
+    
+    // Raw parameter values, looked up once in the constructor so the audio
+    // thread never builds a parameter ID
+    std::atomic<float>* preGainParameter { nullptr };
+    std::atomic<float>* saturatorTypeParameter { nullptr };
+    std::atomic<float>* numBandsParameter { nullptr };
+    std::atomic<float>* crossoverParameters[sauna::maxMultibandBands - 1] {};
+    std::atomic<float>* steamerGainParameter { nullptr };
+    std::atomic<float>* sizzleDensityParameter { nullptr };
+    std::atomic<float>* sizzleGainParameter { nullptr };
+    std::atomic<float>* roomSizeParameter { nullptr };
+    std::atomic<float>* stageOrderParameter { nullptr };
+    std::atomic<float>* lfoRateParameter { nullptr };
+    std::atomic<float>* qualityTierParameter { nullptr };
+    std::atomic<float>* modulationDepthParameters[sauna::numModulationSources][sauna::numModulationDestinations] {};
+    
+    // Per band multiband parameters
+    std::atomic<float>* bandDriveParameters[sauna::maxMultibandBands] {};
+    std::atomic<float>* bandTypeParameters[sauna::maxMultibandBands] {};
+    
+    // One chain per sample type, only the one matching the host's
+    // processing precision is prepared
+    sauna::ExciterChain<float> floatChain;
+    sauna::ExciterChain<double> doubleChain;
+    const juce::uint64 sizzleSeed { static_cast<juce::uint64>(juce::Random::getSystemRandom().nextInt64()) };
+    
+    // Custom curve, the compiler hands its tables to both chains. Nothing is
+    // compiled before the first prepareToPlay, a host may set the play
+    // config before restoring the state so the sample rate does not tell.
+    sauna::TransferCurve customCurve;
+    sauna::TransferCurveCompiler curveCompiler;
+    std::atomic<bool> curveCompilePending { true };
+    std::atomic<bool> prepared { false };
+
+    std::atomic<sauna::QualityTier> activeQualityTier { sauna::QualityTier::Realtime };
+
+    // Load measurement
+    juce::AudioProcessLoadMeasurer loadMeasurer;
+    std::atomic<double> currentLoad { 0.0 };
+    std::atomic<double> peakLoad { 0.0 };
+    
+   #if SAUNA_ENABLE_PROFILING
+    sauna::StageProfiler profiler;
+    std::unique_ptr<sauna::StageProfileExporter> profileExporter;
+   #endif
     
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SaunaSizzlerAudioProcessor)
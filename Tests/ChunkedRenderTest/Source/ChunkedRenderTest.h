@@ -0,0 +1,233 @@
+/*
+  ==============================================================================
+
+    ChunkedRenderTest.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../../../SaunaSizzler/Source/Offline/OfflineRenderer.h"
+
+// How far OfflineRenderer::renderFileInChunks() ends up from renderFile() on
+// the same file
+struct ChunkedRenderResults
+{
+    juce::int64 inputLength { 0 };
+    juce::int64 length { 0 };              // Of the renderFile() output
+    juce::int64 chunkedLength { 0 };
+    int numChunks { 0 };
+
+    double maxDifference { 0.0 };
+    juce::int64 maxDifferencePosition { 0 };
+    double maxDifferenceDb { -200.0 };
+
+    juce::String error;                    // Set if a render failed
+    bool passed { false };
+
+    juce::String toString() const
+    {
+        juce::String text;
+
+        if (error.isNotEmpty()) {
+            text << "Error:                " << error << "\n";
+        }
+
+        text << "Input length:         " << inputLength << " samples\n"
+             << "Output length:        " << length << " / " << chunkedLength << " samples chunked\n"
+             << "Chunks:               " << numChunks << "\n"
+             << "Max difference:       " << juce::String(maxDifferenceDb, 1) << " dBFS at sample " << maxDifferencePosition << "\n"
+             << "Result:               " << (passed ? "pass" : "FAIL") << "\n";
+        return text;
+    }
+};
+
+
+// Writes a stereo file several chunks long, renders it with renderFile()
+// and with renderFileInChunks() and checks that the two have the same length
+// and stay within maxDifferenceDb of each other, the promise of the chunked
+// render. Reverb, steam, sizzle and the LFO are all on, and the first burst
+// ends just before the first chunk boundary, so that join lands in the
+// loudest part of a reverb tail. The chunks are longer than the warm up, so
+// the second one really starts from silence inside the first burst. The
+// second burst runs to the end of the file, and both renders have to play
+// its tail out.
+class ChunkedRenderTest
+{
+public:
+    static constexpr double maxDifferenceDb = -90.0;
+
+    explicit ChunkedRenderTest(double sampleRateToUse = 48000.0, double chunkSecondsToUse = 3.0, int numThreadsToUse = 4)
+        : sampleRate(sampleRateToUse), chunkSeconds(chunkSecondsToUse), numThreads(numThreadsToUse)
+    {
+    }
+
+    ChunkedRenderResults run()
+    {
+        ChunkedRenderResults results;
+
+        const auto directory = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("SaunaChunkedRenderTest");
+        directory.createDirectory();
+
+        const auto source = directory.getChildFile("source.wav");
+        const auto rendered = directory.getChildFile("rendered.wav");
+        const auto chunked = directory.getChildFile("chunked.wav");
+
+        results.error = writeSource(source);
+
+        SaunaSizzlerAudioProcessor processor;
+        setParameters(processor);
+        OfflineRenderer renderer (processor);
+
+        if (results.error.isEmpty()) {
+            results.error = renderer.renderFile(source, rendered);
+        }
+
+        if (results.error.isEmpty()) {
+            results.error = renderer.renderFileInChunks(source, chunked, numThreads, chunkSeconds);
+        }
+
+        if (results.error.isEmpty()) {
+            results.error = compare(rendered, chunked, results);
+        }
+
+        results.inputLength = getInputLength();
+        results.numChunks = static_cast<int>((results.chunkedLength + getChunkSamples() - 1) / getChunkSamples());
+        results.passed = results.error.isEmpty()
+                      && results.length == results.chunkedLength
+                      && results.length > results.inputLength
+                      && results.maxDifferenceDb <= maxDifferenceDb;
+
+        directory.deleteRecursively();
+        return results;
+    }
+
+private:
+    static constexpr int numChannels = 2;
+
+    // Chunks are whole blocks, as in renderFileInChunks()
+    juce::int64 getChunkSamples() const
+    {
+        const auto numBlocks = static_cast<juce::int64>(std::ceil(chunkSeconds * sampleRate / OfflineRenderer::blockSize));
+        return std::max<juce::int64>(numBlocks, 1) * OfflineRenderer::blockSize;
+    }
+
+    juce::int64 getInputLength() const
+    {
+        return 4 * getChunkSamples() + getChunkSamples() / 2;
+    }
+
+    // Everything audible, the LFO on the steam and the sizzle and the
+    // envelope on the sizzle. The room size stays unmodulated, its tail
+    // bounds the warm up of the chunks, 2.4 s at this size.
+    static void setParameters(SaunaSizzlerAudioProcessor& processor)
+    {
+        const std::pair<const char*, float> values[] {
+            { "REVERB_ROOMSIZE", 0.5f },
+            { "STEAMER_GAINDB", -24.0f },
+            { "SIZZLE_DENSITY", 400.0f },
+            { "SIZZLE_GAINDB", -18.0f },
+            { "LFO_RATE", 150.0f },
+            { "MOD_LFO_STEAM", 1.0f },
+            { "MOD_LFO_SIZZLE", 0.5f },
+            { "MOD_LFO_PREGAIN", 0.3f },
+            { "MOD_ENV_SIZZLE", 1.0f }
+        };
+
+        for (const auto& [parameterID, value] : values) {
+            auto* parameter = processor.apvts.getParameter(parameterID);
+            jassert(parameter != nullptr);
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+        }
+    }
+
+    // A tone over noise that stops a tenth of a second before the first
+    // chunk boundary, silence, and a second burst that runs to the end
+    juce::String writeSource(const juce::File& source) const
+    {
+        const auto length = static_cast<int>(getInputLength());
+        const auto firstBurstEnd = static_cast<int>(getChunkSamples() - sampleRate / 10.0);
+        const auto secondBurstStart = static_cast<int>(2 * getChunkSamples() + getChunkSamples() / 3);
+
+        juce::AudioBuffer<float> buffer (numChannels, length);
+        juce::Random random (1);
+        const auto toneStep = juce::MathConstants<double>::twoPi * 330.0 / sampleRate;
+
+        for (int i = 0; i < length; i++) {
+            const auto audible = i < firstBurstEnd || i >= secondBurstStart;
+
+            for (int channel = 0; channel < numChannels; channel++) {
+                const auto tone = 0.4 * std::sin(toneStep * (channel + 1) * i);
+                const auto noise = 0.1 * (2.0 * random.nextDouble() - 1.0);
+                buffer.setSample(channel, i, audible ? static_cast<float>(tone + noise) : 0.0f);
+            }
+        }
+
+        source.deleteFile();
+        std::unique_ptr<juce::OutputStream> stream = source.createOutputStream();
+
+        if (stream == nullptr) {
+            return "Cannot write " + source.getFullPathName();
+        }
+
+        juce::WavAudioFormat wavFormat;
+        std::unique_ptr<juce::AudioFormatWriter> writer (wavFormat.createWriterFor(stream.get(), sampleRate, static_cast<unsigned int>(numChannels), 24, {}, 0));
+
+        if (writer == nullptr) {
+            return "Cannot write " + source.getFullPathName();
+        }
+
+        stream.release();
+        return writer->writeFromAudioSampleBuffer(buffer, 0, length) ? juce::String() : "Cannot write " + source.getFullPathName();
+    }
+
+    static juce::String compare(const juce::File& rendered, const juce::File& chunked, ChunkedRenderResults& results)
+    {
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+
+        std::unique_ptr<juce::AudioFormatReader> renderedReader (formatManager.createReaderFor(rendered));
+        std::unique_ptr<juce::AudioFormatReader> chunkedReader (formatManager.createReaderFor(chunked));
+
+        if (renderedReader == nullptr || chunkedReader == nullptr) {
+            return "Cannot read the renders";
+        }
+
+        results.length = renderedReader->lengthInSamples;
+        results.chunkedLength = chunkedReader->lengthInSamples;
+
+        const auto length = static_cast<int>(std::min(results.length, results.chunkedLength));
+        juce::AudioBuffer<float> renderedBuffer (numChannels, length);
+        juce::AudioBuffer<float> chunkedBuffer (numChannels, length);
+
+        if (! renderedReader->read(&renderedBuffer, 0, length, 0, true, true)
+            || ! chunkedReader->read(&chunkedBuffer, 0, length, 0, true, true)) {
+            return "Cannot read the renders";
+        }
+
+        for (int channel = 0; channel < numChannels; channel++) {
+            const auto* expected = renderedBuffer.getReadPointer(channel);
+            const auto* actual = chunkedBuffer.getReadPointer(channel);
+
+            for (int i = 0; i < length; i++) {
+                const auto difference = std::abs(static_cast<double>(expected[i]) - actual[i]);
+
+                if (difference > results.maxDifference) {
+                    results.maxDifference = difference;
+                    results.maxDifferencePosition = i;
+                }
+            }
+        }
+
+        results.maxDifferenceDb = juce::Decibels::gainToDecibels(results.maxDifference, -200.0);
+        return {};
+    }
+
+    double sampleRate;
+    double chunkSeconds;
+    int numThreads;
+
+    JUCE_DECLARE_NON_COPYABLE (ChunkedRenderTest)
+};
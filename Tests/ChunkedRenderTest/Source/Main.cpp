@@ -0,0 +1,26 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Renders a file with OfflineRenderer::renderFile() and in chunks with
+    renderFileInChunks(), prints how far apart they are and exits with 1 if
+    they differ in length or by more than -90 dBFS anywhere.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "ChunkedRenderTest.h"
+
+int main()
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    ChunkedRenderTest test;
+    const auto results = test.run();
+    std::cout << results.toString();
+
+    return results.passed ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+/*
+  ==============================================================================
+
+    InstantiationBenchmark.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#if JUCE_LINUX || JUCE_BSD
+ #include <unistd.h>
+#elif JUCE_MAC
+ #include <mach/mach.h>
+#elif JUCE_WINDOWS
+ #include <windows.h>
+ #include <psapi.h>
+#endif
+
+// Time and memory it takes to create and destroy plugin instances, the way
+// hosts do when they scan plugins or load a session with many instances
+struct InstantiationResults
+{
+    int numInstances { 0 };
+
+    // The first instance in the process, pays for static and shared resources
+    double coldCreateMs { 0.0 };
+    double coldDestroyMs { 0.0 };
+
+    // Average over the instances after it
+    double warmCreateMs { 0.0 };
+    double warmDestroyMs { 0.0 };
+
+    // Resident memory added per live instance, before and after prepareToPlay.
+    // Zero where the platform does not report it.
+    double bytesPerInstance { 0.0 };
+    double preparedBytesPerInstance { 0.0 };
+
+    juce::String toString() const
+    {
+        juce::String text;
+        text << "Instances:            " << numInstances << "\n"
+             << "Cold create/destroy:  " << juce::String(coldCreateMs, 3) << " ms / " << juce::String(coldDestroyMs, 3) << " ms\n"
+             << "Warm create/destroy:  " << juce::String(warmCreateMs, 3) << " ms / " << juce::String(warmDestroyMs, 3) << " ms\n"
+             << "Memory per instance:  " << juce::String(bytesPerInstance / 1024.0, 1) << " KiB\n"
+             << "Prepared per instance: " << juce::String(preparedBytesPerInstance / 1024.0, 1) << " KiB\n";
+        return text;
+    }
+};
+
+
+class InstantiationBenchmark
+{
+public:
+    using Factory = std::function<std::unique_ptr<juce::AudioProcessor>()>;
+
+    // With withEditors set every instance also opens and closes its editor,
+    // which needs to happen on the message thread
+    InstantiationBenchmark(Factory factoryToUse, int numInstancesToCreate = 100, bool withEditors = false)
+        : factory(std::move(factoryToUse)), numInstances(std::max(numInstancesToCreate, 2)), createEditors(withEditors)
+    {
+    }
+
+    // Run it first thing in the process, otherwise the cold numbers are warm
+    InstantiationResults run(double sampleRate = 48000.0, int blockSize = 512)
+    {
+        InstantiationResults results;
+        results.numInstances = numInstances;
+
+        // Cold
+        {
+            auto startMs = juce::Time::getMillisecondCounterHiRes();
+            auto instance = create();
+            results.coldCreateMs = juce::Time::getMillisecondCounterHiRes() - startMs;
+
+            startMs = juce::Time::getMillisecondCounterHiRes();
+            destroy(std::move(instance));
+            results.coldDestroyMs = juce::Time::getMillisecondCounterHiRes() - startMs;
+        }
+
+        // Warm, all instances stay alive so their memory can be measured
+        std::vector<Instance> instances;
+        instances.reserve(static_cast<size_t>(numInstances));
+
+        const auto bytesBefore = getResidentBytes();
+        auto startMs = juce::Time::getMillisecondCounterHiRes();
+
+        for (int i = 0; i < numInstances; i++) {
+            instances.push_back(create());
+        }
+
+        results.warmCreateMs = (juce::Time::getMillisecondCounterHiRes() - startMs) / numInstances;
+        const auto bytesCreated = getResidentBytes();
+
+        for (auto& instance : instances) {
+            instance.processor->setRateAndBufferSizeDetails(sampleRate, blockSize);
+            instance.processor->prepareToPlay(sampleRate, blockSize);
+        }
+
+        const auto bytesPrepared = getResidentBytes();
+
+        if (bytesBefore > 0) {
+            results.bytesPerInstance = static_cast<double>(bytesCreated - bytesBefore) / numInstances;
+            results.preparedBytesPerInstance = static_cast<double>(bytesPrepared - bytesBefore) / numInstances;
+        }
+
+        for (auto& instance : instances) {
+            instance.processor->releaseResources();
+        }
+
+        startMs = juce::Time::getMillisecondCounterHiRes();
+
+        for (auto& instance : instances) {
+            destroy(std::move(instance));
+        }
+
+        results.warmDestroyMs = (juce::Time::getMillisecondCounterHiRes() - startMs) / numInstances;
+        return results;
+    }
+
+    // Resident set size of the process in bytes, 0 if it is not available
+    static juce::int64 getResidentBytes()
+    {
+       #if JUCE_LINUX || JUCE_BSD
+        const auto fields = juce::StringArray::fromTokens(juce::File("/proc/self/statm").loadFileAsString(), true);
+
+        if (fields.size() > 1) {
+            return fields[1].getLargeIntValue() * static_cast<juce::int64>(sysconf(_SC_PAGESIZE));
+        }
+       #elif JUCE_MAC
+        mach_task_basic_info info;
+        mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+
+        if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) == KERN_SUCCESS) {
+            return static_cast<juce::int64>(info.resident_size);
+        }
+       #elif JUCE_WINDOWS
+        PROCESS_MEMORY_COUNTERS counters;
+
+        if (K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+            return static_cast<juce::int64>(counters.WorkingSetSize);
+        }
+       #endif
+
+        return 0;
+    }
+
+private:
+    struct Instance
+    {
+        std::unique_ptr<juce::AudioProcessor> processor;
+        std::unique_ptr<juce::AudioProcessorEditor> editor;
+    };
+
+    Instance create()
+    {
+        Instance instance;
+        instance.processor = factory();
+
+        if (createEditors && instance.processor->hasEditor()) {
+            instance.editor.reset(instance.processor->createEditorIfNeeded());
+        }
+
+        return instance;
+    }
+
+    // The editor has to go before its processor, it unregisters itself
+    static void destroy(Instance instance)
+    {
+        instance.editor.reset();
+        instance.processor.reset();
+    }
+
+    Factory factory;
+    int numInstances;
+    bool createEditors;
+
+    JUCE_DECLARE_NON_COPYABLE (InstantiationBenchmark)
+};
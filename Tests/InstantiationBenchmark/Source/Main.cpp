@@ -0,0 +1,37 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Creates and destroys SaunaSizzler instances the way a host does when it
+    scans plugins or loads a large session and prints the timings and the
+    memory per instance. Pass --editors to open an editor for every
+    instance as well and --instances N to change the count.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "InstantiationBenchmark.h"
+
+juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter();
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray arguments;
+    for (int i = 1; i < argc; i++) {
+        arguments.add(argv[i]);
+    }
+
+    const auto instancesIndex = arguments.indexOf("--instances");
+    const auto numInstances = instancesIndex >= 0 ? arguments[instancesIndex + 1].getIntValue() : 100;
+
+    InstantiationBenchmark benchmark([] { return std::unique_ptr<juce::AudioProcessor>(createPluginFilter()); },
+                                     numInstances, arguments.contains("--editors"));
+    std::cout << benchmark.run().toString();
+
+    return 0;
+}
@@ -0,0 +1,975 @@
+/*
+  ==============================================================================
+
+    KernelVerifier.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <functional>
+
+namespace sauna {
+
+// Largest deviation a kernel may show against its reference. Infinite
+// entries are reported but not checked.
+struct KernelBudget
+{
+    double maxAbsoluteError { std::numeric_limits<double>::infinity() };
+    double maxAliasIncreaseDb { std::numeric_limits<double>::infinity() };   // Over the reference alias energy
+    double maxAliasDb { std::numeric_limits<double>::infinity() };           // Of the kernel alone
+};
+
+// Accuracy and speed of one optimized kernel against its reference
+struct KernelReport
+{
+    juce::String name;
+    double maxAbsoluteError { 0.0 };     // Over the sweep, the noise and the sine
+    double errorDb { -200.0 };           // Error energy relative to the reference energy
+    double referenceAliasDb { -200.0 };  // Non harmonic energy of the full scale sine
+    double aliasDb { -200.0 };
+    double referenceNsPerSample { 0.0 };
+    double nsPerSample { 0.0 };
+    KernelBudget budget;
+    bool passed { false };
+};
+
+
+// Runs the reference implementations and the optimized kernels of the
+// Saturator, Steamer, SteamerReverb, LinkwitzRileyBank, SizzleGenerator and
+// ModulationMatrix over the same signals: a log sine sweep, seeded white
+// noise and a full scale sine, and checks every kernel against its declared
+// budget. The budgets are never measured values, they come from a bound on
+// the rounding or the approximation of the kernel, or from a stated dB
+// tolerance where no bound exists, see the tolerances at the bottom.
+class KernelVerifier {
+public:
+    explicit KernelVerifier(double sampleRateToUse = 48000.0, juce::int64 seed = 1)
+        : sampleRate(sampleRateToUse)
+    {
+        createSignals(seed);
+    }
+
+    // No copy semantics
+    KernelVerifier(const KernelVerifier&) = delete;
+    const KernelVerifier& operator=(const KernelVerifier&) = delete;
+
+    std::vector<KernelReport> run()
+    {
+        std::vector<KernelReport> reports;
+        const auto unchecked = std::numeric_limits<double>::infinity();
+
+        // The block kernels against the scalar curves in double. The Pade
+        // approximant of the Fast tanh is off by ~1e-8 over the inputs the pre
+        // gain reaches and the fast exp of the Fast tube by 1.5e-7 relative,
+        // both well under the rounding.
+        const SaturationType types[] { SaturationType::Tanh, SaturationType::ASinh, SaturationType::HardClipping,
+                                       SaturationType::SoftClipping, SaturationType::Tube };
+
+        for (auto type : types) {
+            const auto accurateError = type == SaturationType::Tube ? tubeCancellationTolerance : curveRounding;
+            reports.push_back(verifySaturator(type, SaturatorPrecision::Accurate, { accurateError, aliasTolerance }));
+            const auto fastError = curveRounding + (type == SaturationType::Tanh ? getPadeError() : 0.0);
+            reports.push_back(verifySaturator(type, SaturatorPrecision::Fast, { fastError, aliasTolerance }));
+        }
+
+        reports.push_back(verifyCustomCurve({ curveRounding + getTablePositionError(), aliasTolerance }));
+
+        // Every tier as it runs in the plugin against the same oversampling
+        // with the Accurate curves in double, the curve adds to the rounding
+        // of the oversampling filters
+        reports.push_back(verifyQualityTier(QualityTier::Eco, { curveRounding + filterTolerance, aliasTolerance }));
+        reports.push_back(verifyQualityTier(QualityTier::Realtime, { curveRounding + filterTolerance, aliasTolerance }));
+        reports.push_back(verifyQualityTier(QualityTier::Offline, { tubeCancellationTolerance + filterTolerance, aliasTolerance }));
+
+        // Against the pink noise filters in double, drawing the same noise
+        reports.push_back(verifySteamer(NoiseShaping::None, { curveRounding, aliasTolerance }));
+        reports.push_back(verifySteamer(NoiseShaping::Economy, { filterTolerance, aliasTolerance }));
+        reports.push_back(verifySteamer(NoiseShaping::Refined, { filterTolerance, aliasTolerance }));
+
+        // The full rate reverb against juce::Reverb, the half rate one
+        // against juce::Reverb at half the rate with the same averaging and
+        // interpolation. The images of the half rate one are checked against
+        // what the interpolation leaves by design.
+        reports.push_back(verifyReverb({ filterTolerance, aliasTolerance }));
+        reports.push_back(verifyHalfRateReverb({ filterTolerance, aliasTolerance }));
+        reports.push_back(verifyHalfRateImages({ unchecked, unchecked, getInterpolationImageDb() }));
+
+        // Every band of the multiband split against a cascade of
+        // juce::dsp::LinkwitzRileyFilter in double, and the sum of the bands
+        // against the allpasses of the crossovers. The filters are linear, so
+        // there is no aliasing to check.
+        for (int band = 0; band < maxMultibandBands; band++) {
+            reports.push_back(verifyLinkwitzRileyBank(maxMultibandBands, band, { filterTolerance, unchecked }));
+        }
+
+        for (int numBands = 2; numBands <= maxMultibandBands; numBands++) {
+            reports.push_back(verifyLinkwitzRileyBank(numBands, allBands, { filterTolerance, unchecked }));
+        }
+
+        // The grain batches against every grain rendered on its own in
+        // double, and the ramps against the sources evaluated per sample.
+        // Neither passes the sine through, so aliasing is not checked.
+        reports.push_back(verifySizzle({ getSizzleTolerance(), unchecked }));
+        reports.push_back(verifyModulation({ curveRounding + getEnvelopeRounding(), unchecked }));
+
+        return reports;
+    }
+
+    static bool allPassed(const std::vector<KernelReport>& reports)
+    {
+        return std::all_of(reports.begin(), reports.end(), [] (const auto& report) { return report.passed; });
+    }
+
+    // One row per kernel: accuracy against its budget, aliasing and the cost
+    // of both versions
+    static juce::String createTable(const std::vector<KernelReport>& reports)
+    {
+        juce::String table;
+        table << juce::String("Kernel").paddedRight(' ', 34)
+              << juce::String("Max error").paddedLeft(' ', 12)
+              << juce::String("Budget").paddedLeft(' ', 12)
+              << juce::String("Error dB").paddedLeft(' ', 10)
+              << juce::String("Ref alias").paddedLeft(' ', 11)
+              << juce::String("Alias dB").paddedLeft(' ', 10)
+              << juce::String("Ref ns").paddedLeft(' ', 9)
+              << juce::String("ns").paddedLeft(' ', 9)
+              << juce::String("Speedup").paddedLeft(' ', 9)
+              << "  Result\n";
+
+        for (const auto& report : reports) {
+            const auto speedup = report.nsPerSample > 0.0 ? report.referenceNsPerSample / report.nsPerSample : 0.0;
+
+            table << report.name.paddedRight(' ', 34)
+                  << juce::String(report.maxAbsoluteError, 7).paddedLeft(' ', 12)
+                  << juce::String(report.budget.maxAbsoluteError, 7).paddedLeft(' ', 12)
+                  << juce::String(report.errorDb, 1).paddedLeft(' ', 10)
+                  << juce::String(report.referenceAliasDb, 1).paddedLeft(' ', 11)
+                  << juce::String(report.aliasDb, 1).paddedLeft(' ', 10)
+                  << juce::String(report.referenceNsPerSample, 2).paddedLeft(' ', 9)
+                  << juce::String(report.nsPerSample, 2).paddedLeft(' ', 9)
+                  << (juce::String(speedup, 2) + "x").paddedLeft(' ', 9)
+                  << (report.passed ? "  pass\n" : "  FAIL\n");
+        }
+
+        return table;
+    }
+
+private:
+    using Signal = std::vector<double>;
+    using Render = std::function<void(const Signal& input, Signal& output)>;
+    using RenderFactory = std::function<Render()>;
+
+    static constexpr int fftOrder = 12;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int signalLength = 4 * fftSize;
+    static constexpr int blockSize = 512;
+    static constexpr int numTimingRuns = 5;
+
+    // The sine sits exactly on a bin so there is no leakage, and the bin is
+    // prime so no harmonic folds back onto a multiple of it. Around 10 kHz at
+    // 48 kHz, from the third harmonic up everything folds.
+    static constexpr int sineBin = 853;
+
+    void createSignals(juce::int64 seed)
+    {
+        sweep.resize(signalLength);
+        noise.resize(signalLength);
+        sine.resize(signalLength);
+
+        const auto startHz = 20.0;
+        const auto endHz = std::min(20000.0, 0.45 * sampleRate);
+        const auto duration = signalLength / sampleRate;
+        const auto k = std::log(endHz / startHz);
+        juce::Random random(seed);
+
+        for (int i = 0; i < signalLength; i++) {
+            const auto t = i / sampleRate;
+            const auto index = static_cast<size_t>(i);
+            sweep[index] = std::sin(juce::MathConstants<double>::twoPi * startHz * duration / k * (std::exp(k * t / duration) - 1.0));
+            noise[index] = 2.0 * random.nextDouble() - 1.0;
+            sine[index] = std::sin(juce::MathConstants<double>::twoPi * sineBin * i / fftSize);
+        }
+    }
+
+    KernelReport verify(const juce::String& name, KernelBudget budget, RenderFactory makeReference, RenderFactory makeOptimized)
+    {
+        KernelReport report;
+        report.name = name;
+        report.budget = budget;
+
+        double errorEnergy = 0.0;
+        double referenceEnergy = 0.0;
+        Signal referenceOutput, optimizedOutput;
+
+        for (const auto* signal : { &sweep, &noise, &sine }) {
+            makeReference()(*signal, referenceOutput);
+            makeOptimized()(*signal, optimizedOutput);
+
+            for (size_t i = 0; i < signal->size(); i++) {
+                const auto error = optimizedOutput[i] - referenceOutput[i];
+                report.maxAbsoluteError = std::max(report.maxAbsoluteError, std::abs(error));
+                errorEnergy += error * error;
+                referenceEnergy += referenceOutput[i] * referenceOutput[i];
+            }
+
+            if (signal == &sine) {
+                report.referenceAliasDb = measureAliasDb(referenceOutput);
+                report.aliasDb = measureAliasDb(optimizedOutput);
+            }
+        }
+
+        report.errorDb = toDecibels(errorEnergy / std::max(referenceEnergy, 1.0e-30));
+        report.referenceNsPerSample = measureSpeed(makeReference);
+        report.nsPerSample = measureSpeed(makeOptimized);
+        report.passed = report.maxAbsoluteError <= budget.maxAbsoluteError
+                     && report.aliasDb - report.referenceAliasDb <= budget.maxAliasIncreaseDb
+                     && report.aliasDb <= budget.maxAliasDb;
+        return report;
+    }
+
+    // Energy outside the harmonics of the sine over the total, taken from the
+    // last fftSize samples once the kernel has settled
+    static double measureAliasDb(const Signal& output)
+    {
+        std::vector<float> spectrum(2 * fftSize, 0.0f);
+        const auto start = output.size() - static_cast<size_t>(fftSize);
+
+        for (size_t i = 0; i < static_cast<size_t>(fftSize); i++) {
+            spectrum[i] = static_cast<float>(output[start + i]);
+        }
+
+        juce::dsp::FFT fft(fftOrder);
+        fft.performFrequencyOnlyForwardTransform(spectrum.data());
+
+        double aliasEnergy = 0.0;
+        double totalEnergy = 0.0;
+
+        for (int bin = 1; bin <= fftSize / 2; bin++) {
+            const auto energy = static_cast<double>(spectrum[static_cast<size_t>(bin)]) * spectrum[static_cast<size_t>(bin)];
+            totalEnergy += energy;
+
+            if (bin % sineBin != 0) {
+                aliasEnergy += energy;
+            }
+        }
+
+        return toDecibels(aliasEnergy / std::max(totalEnergy, 1.0e-30));
+    }
+
+    // Best of a few runs over the noise, state is created outside the timing
+    double measureSpeed(RenderFactory makeRender)
+    {
+        Signal output;
+        auto best = std::numeric_limits<double>::max();
+
+        for (int run = 0; run < numTimingRuns; run++) {
+            auto render = makeRender();
+            const auto startTicks = juce::Time::getHighResolutionTicks();
+            render(noise, output);
+            const auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+            best = std::min(best, seconds);
+        }
+
+        return best * 1.0e9 / signalLength;
+    }
+
+    static double toDecibels(double energyRatio)
+    {
+        return energyRatio > 1.0e-20 ? 10.0 * std::log10(energyRatio) : -200.0;
+    }
+
+    // Feeds a signal through processBlock(SampleType* data, int numSamples)
+    // in blocks of the sample type the kernel runs at
+    template <typename SampleType, typename Function>
+    static Render renderInBlocks(Function processBlock)
+    {
+        return [processBlock] (const Signal& input, Signal& output) mutable {
+            SampleType block[blockSize];
+            output.resize(input.size());
+
+            for (size_t start = 0; start < input.size(); start += blockSize) {
+                const auto n = std::min(static_cast<size_t>(blockSize), input.size() - start);
+
+                for (size_t i = 0; i < n; i++) {
+                    block[i] = static_cast<SampleType>(input[start + i]);
+                }
+
+                processBlock(block, static_cast<int>(n));
+
+                for (size_t i = 0; i < n; i++) {
+                    output[start + i] = static_cast<double>(block[i]);
+                }
+            }
+        };
+    }
+
+    juce::dsp::ProcessSpec getSpec() const
+    {
+        return { sampleRate, static_cast<juce::uint32>(blockSize), 1 };
+    }
+
+    static const char* getTypeName(SaturationType type)
+    {
+        switch (type) {
+            case SaturationType::Tanh:         return "Tanh";
+            case SaturationType::ASinh:        return "ASinh";
+            case SaturationType::HardClipping: return "Hard clipping";
+            case SaturationType::SoftClipping: return "Soft clipping";
+            case SaturationType::Tube:         return "Tube";
+            case SaturationType::Custom:       return "Custom";
+        }
+
+        return "Unknown";
+    }
+
+    // Scalar curve in double against the float block kernel, same pre gain
+    KernelReport verifySaturator(SaturationType type, SaturatorPrecision precision, KernelBudget budget)
+    {
+        const auto name = juce::String("Saturator ") + getTypeName(type)
+                        + (precision == SaturatorPrecision::Fast ? " Fast" : " Accurate");
+
+        auto makeReference = [type] {
+            auto saturator = std::make_shared<Saturator<double>>();
+            saturator->setSaturation(type);
+            saturator->reset();
+            const auto gain = juce::Decibels::decibelsToGain(preGainDb);
+
+            return renderInBlocks<double>([saturator, gain] (double* data, int n) {
+                for (int i = 0; i < n; i++) {
+                    data[i] = saturator->saturate(gain * data[i]);
+                }
+            });
+        };
+
+        auto makeOptimized = [type, precision] {
+            auto saturator = std::make_shared<Saturator<float>>();
+            saturator->setSaturation(type);
+            saturator->setPrecision(precision);
+            saturator->setPreGain(static_cast<float>(preGainDb));
+            saturator->reset();
+
+            return renderInBlocks<float>([saturator] (float* data, int n) {
+                float* channels[1] { data };
+                saturator->process(channels, channels, 1, static_cast<unsigned int>(n));
+            });
+        };
+
+        return verify(name, budget, makeReference, makeOptimized);
+    }
+
+    // A spline curve, so the check does not depend on the expression parser
+    static std::shared_ptr<CompiledCurve> compileCustomCurve()
+    {
+        const auto curve = TransferCurve::fromControlPoints({ { -4.0, -1.0 }, { -1.0, -0.7 }, { 0.0, 0.0 }, { 0.5, 0.55 }, { 4.0, 1.0 } });
+        auto compiled = std::make_shared<CompiledCurve>();
+        juce::String error;
+
+        if (! TransferCurveCompiler::compileCurve(curve, *compiled, error)) {
+            // If you hit this assertion the spline above no longer compiles
+            jassertfalse;
+            return nullptr;
+        }
+
+        return compiled;
+    }
+
+    // The interpolated table in double against the float table
+    KernelReport verifyCustomCurve(KernelBudget budget)
+    {
+        const auto compiled = compileCustomCurve();
+
+        if (compiled == nullptr) {
+            KernelReport report;
+            report.name = "Saturator Custom";
+            return report;
+        }
+
+        auto makeReference = [compiled] {
+            auto table = std::make_shared<CurveTable<double>>(*compiled);
+            const auto gain = juce::Decibels::decibelsToGain(preGainDb);
+
+            return renderInBlocks<double>([table, gain] (double* data, int n) {
+                for (int i = 0; i < n; i++) {
+                    data[i] = table->evaluate(gain * data[i]);
+                }
+            });
+        };
+
+        auto makeOptimized = [compiled] {
+            auto saturator = std::make_shared<Saturator<float>>();
+            saturator->setCustomCurve(std::make_unique<CurveTable<float>>(*compiled));
+            saturator->setSaturation(SaturationType::Custom);
+            saturator->setPreGain(static_cast<float>(preGainDb));
+            saturator->reset();
+
+            return renderInBlocks<float>([saturator] (float* data, int n) {
+                float* channels[1] { data };
+                saturator->process(channels, channels, 1, static_cast<unsigned int>(n));
+            });
+        };
+
+        return verify("Saturator Custom", budget, makeReference, makeOptimized);
+    }
+
+    // The whole oversampled saturator as a tier runs it, against the same
+    // oversampling order with the Accurate curves in double. The filters are
+    // the same on both sides, so the difference is down to the curves.
+    KernelReport verifyQualityTier(QualityTier tier, KernelBudget budget)
+    {
+        const char* tierNames[] { "Eco", "Realtime", "Offline" };
+        const auto name = juce::String("Saturator tier ") + tierNames[static_cast<int>(tier)];
+        const auto spec = getSpec();
+        const auto settings = getQualitySettings(tier);
+
+        auto makeProcessor = [spec, settings] (auto sample, SaturatorPrecision precision) {
+            using SampleType = decltype(sample);
+            auto processor = std::make_shared<SaturatorProcessor<SampleType>>();
+            processor->prepare(spec);
+            processor->setOversamplingOrder(settings.oversamplingOrder);
+            processor->saturator.setPrecision(precision);
+            processor->saturator.setPreGain(static_cast<float>(preGainDb));
+            processor->saturator.setSaturation(SaturationType::Tube);
+            processor->reset();
+
+            return renderInBlocks<SampleType>([processor] (SampleType* data, int n) {
+                SampleType* channels[1] { data };
+                juce::dsp::AudioBlock<SampleType> block(channels, 1, static_cast<size_t>(n));
+                processor->process(juce::dsp::ProcessContextReplacing<SampleType>(block));
+            });
+        };
+
+        return verify(name, budget,
+                      [makeProcessor] { return makeProcessor(0.0, SaturatorPrecision::Accurate); },
+                      [makeProcessor, settings] { return makeProcessor(0.0f, settings.saturatorPrecision); });
+    }
+
+    // The shaping filters written out in double, fed from the same
+    // juce::Random sequence as the Steamer, one draw per mono sample
+    KernelReport verifySteamer(NoiseShaping shaping, KernelBudget budget)
+    {
+        const char* shapingNames[] { "None", "Economy", "Refined" };
+        const auto name = juce::String("Steamer ") + shapingNames[static_cast<int>(shaping)];
+        const auto spec = getSpec();
+
+        auto makeReference = [shaping] {
+            auto random = std::make_shared<juce::Random>(steamerNoiseSeed);
+            auto state = std::make_shared<std::array<double, 7>>();
+            state->fill(0.0);
+            const auto gain = juce::Decibels::decibelsToGain(steamerGainDb);
+
+            return renderInBlocks<double>([random, state, shaping, gain] (double* data, int n) {
+                for (int i = 0; i < n; i++) {
+                    data[i] += gain * shapeNoise(shaping, random->nextFloat(), *state);
+                }
+            });
+        };
+
+        auto makeOptimized = [spec, shaping] {
+            auto steamer = std::make_shared<Steamer<float>>();
+            steamer->prepare(spec);
+            steamer->setGain(static_cast<float>(steamerGainDb));
+            steamer->setNoiseShaping(shaping);
+
+            return renderInBlocks<float>([steamer] (float* data, int n) {
+                const float unity[2] { 1.f, 1.f };
+                steamer->process(data, data, unity, 1, static_cast<unsigned int>(n));
+            });
+        };
+
+        return verify(name, budget, makeReference, makeOptimized);
+    }
+
+    static double shapeNoise(NoiseShaping shaping, float draw, std::array<double, 7>& b)
+    {
+        const auto white = static_cast<double>(draw);
+
+        if (shaping == NoiseShaping::None) {
+            return white;
+        }
+
+        const auto x = white - 0.5;
+
+        if (shaping == NoiseShaping::Economy) {
+            b[0] = 0.99765 * b[0] + x * 0.0990460;
+            b[1] = 0.96300 * b[1] + x * 0.2965164;
+            b[2] = 0.57000 * b[2] + x * 1.0526913;
+            return 0.5 + 0.338 * (b[0] + b[1] + b[2] + x * 0.1848);
+        }
+
+        b[0] = 0.99886 * b[0] + x * 0.0555179;
+        b[1] = 0.99332 * b[1] + x * 0.0750759;
+        b[2] = 0.96900 * b[2] + x * 0.1538520;
+        b[3] = 0.86650 * b[3] + x * 0.3104856;
+        b[4] = 0.55000 * b[4] + x * 0.5329522;
+        b[5] = -0.7616 * b[5] - x * 0.0168980;
+        const auto pink = b[0] + b[1] + b[2] + b[3] + b[4] + b[5] + b[6] + x * 0.5362;
+        b[6] = x * 0.115926;
+        return 0.5 + 0.331 * pink;
+    }
+
+    Render makeSteamerReverb(int rateDivisor, const juce::Reverb::Parameters& parameters = reverbParameters) const
+    {
+        auto reverb = std::make_shared<SteamerReverb<float>>();
+        reverb->setParameters(parameters);
+        reverb->setRateDivisor(rateDivisor);
+        reverb->prepare(getSpec());
+
+        return renderInBlocks<float>([reverb] (float* data, int n) {
+            reverb->process(data, data, nullptr, 1, static_cast<unsigned int>(n));
+        });
+    }
+
+    Render makeJuceReverb(const juce::Reverb::Parameters& parameters = reverbParameters) const
+    {
+        auto reverb = std::make_shared<juce::Reverb>();
+        reverb->setParameters(parameters);
+        reverb->setSampleRate(sampleRate);
+
+        return renderInBlocks<float>([reverb] (float* data, int n) {
+            reverb->processMono(data, n);
+        });
+    }
+
+    // The full rate reverb against juce::Reverb, which it was taken from
+    KernelReport verifyReverb(KernelBudget budget)
+    {
+        return verify("SteamerReverb full rate", budget,
+                      [this] { return makeJuceReverb(); },
+                      [this] { return makeSteamerReverb(1); });
+    }
+
+    // The half rate reverb against the whole signal put through the same
+    // steps in one go: pairs of samples averaged into juce::Reverb at half
+    // the rate, its output linearly interpolated back up one pair late and
+    // the dry signal added at the full rate
+    KernelReport verifyHalfRateReverb(KernelBudget budget)
+    {
+        auto makeReference = [this] {
+            return Render([halfRate = sampleRate / 2.0] (const Signal& input, Signal& output) {
+                auto wetParameters = reverbParameters;
+                wetParameters.dryLevel = 0.0f;
+                juce::Reverb reverb;
+                reverb.setParameters(wetParameters);
+                reverb.setSampleRate(halfRate);
+
+                std::vector<float> wet(input.size() / 2);
+
+                for (size_t k = 0; k < wet.size(); k++) {
+                    wet[k] = 0.5f * (static_cast<float>(input[2 * k]) + static_cast<float>(input[2 * k + 1]));
+                }
+
+                reverb.processMono(wet.data(), static_cast<int>(wet.size()));
+
+                auto wetAt = [&wet] (juce::int64 k) { return k >= 0 ? wet[static_cast<size_t>(k)] : 0.0f; };
+                const auto dryGain = reverbParameters.dryLevel * 2.0f;
+                output.resize(input.size());
+
+                for (size_t i = 0; i < input.size(); i++) {
+                    const auto k = static_cast<juce::int64>(i / 2);
+                    const auto interpolated = i % 2 == 1 ? wetAt(k - 1) : 0.5f * (wetAt(k - 2) + wetAt(k - 1));
+                    output[i] = static_cast<double>(static_cast<float>(input[i]) * dryGain + interpolated);
+                }
+            });
+        };
+
+        return verify("SteamerReverb half rate", budget, makeReference, [this] { return makeSteamerReverb(2); });
+    }
+
+    // The half rate reverb has its own delay lengths, so against the full
+    // rate only the images of the interpolation count. Without the dry
+    // signal they are all there is besides the harmonics.
+    KernelReport verifyHalfRateImages(KernelBudget budget)
+    {
+        auto wetParameters = reverbParameters;
+        wetParameters.dryLevel = 0.0f;
+
+        return verify("SteamerReverb half rate images", budget,
+                      [this, wetParameters] { return makeJuceReverb(wetParameters); },
+                      [this, wetParameters] { return makeSteamerReverb(2, wetParameters); });
+    }
+
+    // One band of the bank, or the sum of all of them, against
+    // juce::dsp::LinkwitzRileyFilter in double. Band b is the highpasses of
+    // the crossovers below it, the lowpass of its own and the allpasses of the
+    // ones above, the sum is the allpasses of all of them.
+    KernelReport verifyLinkwitzRileyBank(int numBands, int band, KernelBudget budget)
+    {
+        const auto name = juce::String("LinkwitzRileyBank ") + juce::String(numBands) + " bands "
+                        + (band == allBands ? juce::String("sum") : "band " + juce::String(band));
+        const auto spec = getSpec();
+
+        auto makeReference = [spec, numBands, band] {
+            using Filter = juce::dsp::LinkwitzRileyFilter<double>;
+            auto filters = std::make_shared<std::vector<Filter>>(static_cast<size_t>(numBands - 1));
+
+            for (int crossover = 0; crossover < numBands - 1; crossover++) {
+                auto& filter = (*filters)[static_cast<size_t>(crossover)];
+
+                if (band == allBands || crossover > band) {
+                    filter.setType(Filter::Type::allpass);
+                } else {
+                    filter.setType(crossover < band ? Filter::Type::highpass : Filter::Type::lowpass);
+                }
+
+                filter.prepare(spec);
+                filter.setCutoffFrequency(crossoverFrequencies[crossover]);
+            }
+
+            return renderInBlocks<double>([filters] (double* data, int n) {
+                for (int i = 0; i < n; i++) {
+                    for (auto& filter : *filters) {
+                        data[i] = filter.processSample(0, data[i]);
+                    }
+                }
+            });
+        };
+
+        auto makeOptimized = [spec, numBands, band] {
+            auto bank = std::make_shared<LinkwitzRileyBank<float>>();
+            auto bandBuffer = std::make_shared<juce::AudioBuffer<float>>(maxMultibandBands, blockSize);
+            bank->setNumBands(numBands);
+
+            for (int crossover = 0; crossover < numCrossovers; crossover++) {
+                bank->setCrossoverFrequency(crossover, static_cast<float>(crossoverFrequencies[crossover]));
+            }
+
+            bank->prepare(spec.sampleRate);
+
+            return renderInBlocks<float>([bank, bandBuffer, numBands, band] (float* data, int n) {
+                const float* input[1] { data };
+                float* const* bands[1] { bandBuffer->getArrayOfWritePointers() };
+                bank->process(input, bands, 1, n);
+
+                for (int i = 0; i < n; i++) {
+                    if (band != allBands) {
+                        data[i] = bandBuffer->getSample(band, i);
+                        continue;
+                    }
+
+                    data[i] = 0.0f;
+
+                    for (int b = 0; b < numBands; b++) {
+                        data[i] += bandBuffer->getSample(b, i);
+                    }
+                }
+            });
+        };
+
+        return verify(name, budget, makeReference, makeOptimized);
+    }
+
+    // Every grain rendered on its own in double, started from the same
+    // hashes as SizzleGenerator: one of the position plus the hashed seed
+    // per sample, the grain parameters drawn from the hash of that
+    KernelReport verifySizzle(KernelBudget budget)
+    {
+        const auto spec = getSpec();
+
+        auto makeReference = [sampleRateToUse = sampleRate] {
+            struct Grain
+            {
+                double x, increment, amplitude, a1, a2, a3, k, s1, s2;
+                int noiseIndex;
+            };
+
+            auto grains = std::make_shared<std::vector<Grain>>();
+            auto position = std::make_shared<juce::uint64>(0);
+            auto noise = std::make_shared<std::vector<double>>(createSizzleNoise());
+            const auto gain = juce::Decibels::decibelsToGain(sizzleGainDb);
+
+            return renderInBlocks<double>([grains, position, noise, gain, sampleRateToUse] (double* data, int n) {
+                const auto seedOffset = splitMix(sizzleSeed);
+
+                for (int i = 0; i < n; i++) {
+                    auto hash = splitMix(*position + seedOffset + static_cast<juce::uint64>(i));
+
+                    if (toUnit(hash) >= sizzleDensity / sampleRateToUse) {
+                        continue;
+                    }
+
+                    hash = splitMix(hash);
+
+                    const auto unit = [&hash] {
+                        hash = splitMix(hash);
+                        return toUnit(hash);
+                    };
+
+                    const auto lengthSeconds = 0.002 + 0.008 * unit();
+                    const auto frequency = std::min(2500.0 * std::pow(4.4, unit()), 0.45 * sampleRateToUse);
+                    const auto k = 1.0 / (2.0 + 6.0 * unit());
+                    const auto level = 0.25 + 0.75 * unit();
+
+                    // The pan, which a mono render leaves out
+                    unit();
+
+                    const auto increment = 1.0 / (lengthSeconds * sampleRateToUse);
+                    const auto g = std::tan(juce::MathConstants<double>::pi * frequency / sampleRateToUse);
+                    const auto a1 = 1.0 / (1.0 + g * (g + k));
+                    grains->push_back({ -i * increment, increment, 6.75 * level * gain, a1, g * a1, g * g * a1, k, 0.0, 0.0,
+                                        static_cast<int>(hash >> 40) & (sizzleNoiseSize - 1) });
+                }
+
+                for (auto& grain : *grains) {
+                    for (int i = 0; i < n; i++) {
+                        const auto envelope = juce::jlimit(0.0, 1.0, grain.x);
+                        const auto input = (*noise)[static_cast<size_t>((grain.noiseIndex + i) & (sizzleNoiseSize - 1))]
+                                         * grain.amplitude * envelope * (1.0 - envelope) * (1.0 - envelope);
+
+                        const auto v3 = input - grain.s2;
+                        const auto v1 = grain.a1 * grain.s1 + grain.a2 * v3;
+                        const auto v2 = grain.s2 + grain.a2 * grain.s1 + grain.a3 * v3;
+                        grain.s1 = 2.0 * v1 - grain.s1;
+                        grain.s2 = 2.0 * v2 - grain.s2;
+                        data[i] += grain.k * v1;
+                        grain.x += grain.increment;
+                    }
+
+                    grain.noiseIndex = (grain.noiseIndex + n) & (sizzleNoiseSize - 1);
+                }
+
+                grains->erase(std::remove_if(grains->begin(), grains->end(), [] (const auto& grain) { return grain.x >= 1.5; }), grains->end());
+                *position += static_cast<juce::uint64>(n);
+            });
+        };
+
+        auto makeOptimized = [spec] {
+            auto sizzle = std::make_shared<SizzleGenerator<float>>();
+            sizzle->prepare(spec);
+            sizzle->setDensity(static_cast<float>(sizzleDensity));
+            sizzle->setGain(static_cast<float>(sizzleGainDb));
+            sizzle->setSeed(sizzleSeed);
+
+            return renderInBlocks<float>([sizzle] (float* data, int n) {
+                sizzle->process(data, data, nullptr, nullptr, n);
+
+                // If you hit this assertion the pool overflowed and the
+                // reference, which has no cap, plays grains this one dropped
+                jassert(sizzle->getNumDroppedGrains() == 0);
+            });
+        };
+
+        return verify("SizzleGenerator grains", budget, makeReference, makeOptimized);
+    }
+
+    // The noise table of SizzleGenerator
+    static std::vector<double> createSizzleNoise()
+    {
+        juce::Random random(sizzleNoiseSeed);
+        std::vector<double> values(static_cast<size_t>(sizzleNoiseSize));
+
+        for (auto& value : values) {
+            value = static_cast<double>(random.nextFloat() * 2.0f - 1.0f);
+        }
+
+        return values;
+    }
+
+    // splitmix64 finaliser, as SizzleGenerator hashes with it
+    static juce::uint64 splitMix(juce::uint64 value)
+    {
+        value += 0x9e3779b97f4a7c15ULL;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+        return value ^ (value >> 31);
+    }
+
+    static double toUnit(juce::uint64 value)
+    {
+        return static_cast<double>(value >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    // The sources evaluated for every sample in double: the envelope at the
+    // ticks ramped linearly to the next one, the LFO a sine of the sample
+    // index. The input drives the envelope, the output is the pre gain ramp.
+    KernelReport verifyModulation(KernelBudget budget)
+    {
+        const auto spec = getSpec();
+
+        auto makeReference = [sampleRateToUse = sampleRate] {
+            return Render([sampleRateToUse] (const Signal& input, Signal& output) {
+                const auto tickRate = sampleRateToUse / modulationControlInterval;
+                const auto attack = std::exp(-1000.0 / (modulationAttackMs * tickRate));
+                const auto release = std::exp(-1000.0 / (modulationReleaseMs * tickRate));
+                double envelope = 0.0, peak = 0.0, start = 0.0, target = 0.0;
+                output.resize(input.size());
+
+                for (size_t i = 0; i < input.size(); i++) {
+                    const auto sinceTick = static_cast<int>(i % modulationControlInterval);
+
+                    if (sinceTick == 0) {
+                        const auto level = std::min(peak, 1.0);
+                        envelope = level + (level > envelope ? attack : release) * (envelope - level);
+                        peak = 0.0;
+                        start = i == 0 ? modulationDepth * (envelope - 1.0) : target;
+                        target = modulationDepth * (envelope - 1.0);
+                    }
+
+                    peak = std::max(peak, std::abs(static_cast<double>(static_cast<float>(input[i]))));
+
+                    const auto ramp = start + (target - start) * (sinceTick + 1) / modulationControlInterval;
+                    const auto phase = juce::MathConstants<double>::twoPi * modulationLfoRate * static_cast<double>(i) / sampleRateToUse;
+                    const auto lfo = 0.5 * std::sin(phase) - 0.5;
+                    output[i] = juce::jlimit(0.0, 1.0, 1.0 + ramp + modulationDepth * lfo);
+                }
+            });
+        };
+
+        auto makeOptimized = [spec] {
+            auto matrix = std::make_shared<ModulationMatrix<float>>();
+            matrix->setControlInterval(modulationControlInterval);
+            matrix->setEnvelopeTimes(static_cast<float>(modulationAttackMs), static_cast<float>(modulationReleaseMs));
+            matrix->setLfoRate(static_cast<float>(modulationLfoRate));
+            matrix->setDepth(ModulationSource::Lfo, ModulationDestination::PreGain, static_cast<float>(modulationDepth));
+            matrix->setDepth(ModulationSource::Envelope, ModulationDestination::PreGain, static_cast<float>(modulationDepth));
+            matrix->prepare(spec);
+
+            return renderInBlocks<float>([matrix] (float* data, int n) {
+                float* channels[1] { data };
+                matrix->process(juce::dsp::AudioBlock<float>(channels, 1, static_cast<size_t>(n)));
+
+                const auto* ramp = matrix->getRamp(ModulationDestination::PreGain, 0);
+                std::copy(ramp, ramp + n, data);
+            });
+        };
+
+        return verify("ModulationMatrix control rate", budget, makeReference, makeOptimized);
+    }
+
+    // Largest error of the Pade approximant behind the Fast tanh over the
+    // inputs the pre gain can reach, evaluated in double
+    static double getPadeError()
+    {
+        const auto limit = juce::Decibels::decibelsToGain(preGainDb);
+        const auto numSteps = 100000;
+        double error = 0.0;
+
+        for (int i = 0; i <= numSteps; i++) {
+            const auto x = limit * i / numSteps;
+            error = std::max(error, std::abs(juce::dsp::FastMathApproximations::tanh(x) - std::tanh(x)));
+        }
+
+        return error;
+    }
+
+    // The float table rounds the input to the pre gain, the shift by the
+    // input range and the scale to a position, together under two ulps of
+    // the shifted range, which moves the output by up to the steepest slope
+    // of the curve
+    static double getTablePositionError()
+    {
+        const auto compiled = compileCustomCurve();
+
+        if (compiled == nullptr) {
+            return 0.0;
+        }
+
+        const auto step = 2.0 * compiled->inputRange / (numCurveTablePoints - 1);
+        double slope = 0.0;
+
+        for (size_t i = 1; i < compiled->values.size(); i++) {
+            slope = std::max(slope, std::abs(compiled->values[i] - compiled->values[i - 1]) / step);
+        }
+
+        return slope * 2.0 * getFloatUlp(2.0 * compiled->inputRange);
+    }
+
+    // The half rate reverb interpolates with a triangle, which passes a tone
+    // at f with cos^2(pi f / fs) and leaves an image at fs / 2 - f with
+    // sin^2(pi f / fs). Of a wet tone tan^4(pi f / fs) of the energy is in
+    // the image, the 1 dB on top covers the non harmonic energy of the
+    // reverb's own decay.
+    static double getInterpolationImageDb()
+    {
+        const auto image = std::pow(std::tan(juce::MathConstants<double>::pi * sineBin / fftSize), 4.0);
+        return toDecibels(image / (1.0 + image)) + 1.0;
+    }
+
+    // The envelope is a one pole at the tick rate in float. The rounding of
+    // its coefficient and of every tick, an ulp each, adds up to at most
+    // 1 / (1 - coefficient) of it with the slower release coefficient.
+    double getEnvelopeRounding() const
+    {
+        const auto release = std::exp(-1000.0 / (modulationReleaseMs * sampleRate / modulationControlInterval));
+        return modulationDepth * 2.0 * floatUlp / (1.0 - release);
+    }
+
+    // The envelope position of a grain is summed up in float, and from the
+    // start of the block it was started in to its end, blockSize samples and
+    // 10 ms at most, drifts by up to half an ulp per sample. Through the
+    // steepest slope of the envelope, 6.75 at the start, and the sizzle gain
+    // that bounds the error at the input of the band pass, which has unity
+    // gain at its centre. The noise of every grain is independent, so the
+    // errors of overlapping grains do not add up in phase.
+    double getSizzleTolerance() const
+    {
+        const auto numSamples = blockSize + 0.010 * sampleRate;
+        return 6.75 * juce::Decibels::decibelsToGain(sizzleGainDb) * numSamples * 0.5 * floatUlp;
+    }
+
+    static double getFloatUlp(double value)
+    {
+        return std::ldexp(floatUlp, std::ilogb(value));
+    }
+
+    // Same drive as the plugin default, enough to reach the curved part
+    static constexpr double preGainDb = 6.0;
+
+    // Steamer defaults, a default constructed juce::Random starts from 1
+    static constexpr juce::int64 steamerNoiseSeed = 1;
+    static constexpr double steamerGainDb = -12.0;
+
+    // A density the pool never overflows at, the default gain
+    static constexpr double sizzleDensity = 1000.0;
+    static constexpr double sizzleGainDb = -12.0;
+    static constexpr juce::uint64 sizzleSeed = 0x1234;
+
+    // SizzleGenerator's noise table
+    static constexpr juce::int64 sizzleNoiseSeed = 0x5a17;
+    static constexpr int sizzleNoiseSize = 8192;
+
+    // ModulationMatrix defaults, both sources half way into the pre gain
+    static constexpr int modulationControlInterval = 32;
+    static constexpr double modulationAttackMs = 5.0;
+    static constexpr double modulationReleaseMs = 150.0;
+    static constexpr double modulationLfoRate = 100.0;
+    static constexpr double modulationDepth = 0.5;
+
+    // The plugin's default crossovers
+    static constexpr double crossoverFrequencies[numCrossovers] { 150.0, 1500.0, 6000.0 };
+    static constexpr int allBands = -1;
+
+    static inline const juce::Reverb::Parameters reverbParameters { 0.5f, 0.5f, 0.5f, 0.4f, 1.0f, 0.0f };
+
+    // The tolerances the budgets are built from.
+    //
+    // A float kernel against a double reference rounds its input and every
+    // operation by at most half an ulp of the result. None of the curves
+    // runs more than a dozen operations on values under 2, so 16 ulps of full
+    // scale bound them.
+    static constexpr double floatUlp = 1.1920928955078125e-7;
+    static constexpr double curveRounding = 16.0 * floatUlp;
+
+    // Recursive filters carry their rounding on from sample to sample, and
+    // how far depends on the signal. They are held to -100 dBFS, under the
+    // least significant bit of 16 bit audio.
+    static constexpr double filterTolerance = 1.0e-5;
+
+    // 1 - e^u of the Accurate tube curve cancels in float near tubeQ, the
+    // error grows as half an ulp / (tubeDist * |x - tubeQ|) with no bound at
+    // tubeQ. It is held to -80 dBFS, which inputs further than ~1e-5 from
+    // tubeQ meet. The Fast curve uses a series there instead.
+    static constexpr double tubeCancellationTolerance = 1.0e-4;
+
+    // An error adds the most non harmonic energy when it is all in phase
+    // with it, 20 log10(1 + 10^(-39 / 20)) = 0.1 dB for an error 39 dB under
+    // it. The error budgets keep every kernel far below that.
+    static constexpr double aliasTolerance = 0.1;
+
+    double sampleRate;
+    Signal sweep, noise, sine;
+};
+
+} // end sauna namespace
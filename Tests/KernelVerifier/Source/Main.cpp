@@ -0,0 +1,24 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Runs every kernel of the exciter against its reference, prints the
+    accuracy and speed table and exits with 1 if any kernel is over its
+    budget.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "KernelVerifier.h"
+
+int main()
+{
+    sauna::KernelVerifier verifier;
+    const auto reports = verifier.run();
+    std::cout << sauna::KernelVerifier::createTable(reports);
+
+    return sauna::KernelVerifier::allPassed(reports) ? 0 : 1;
+}
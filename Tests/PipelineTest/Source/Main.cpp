@@ -0,0 +1,24 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Renders one signal through the exciter chain and through the pipeline
+    in every stage order, prints the throughput of both and exits with 1 if
+    the outputs are not bit identical.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "PipelineTest.h"
+
+int main()
+{
+    sauna::PipelineTest test;
+    const auto reports = test.run();
+    std::cout << test.createTable(reports);
+
+    return sauna::PipelineTest::allPassed(reports) ? 0 : 1;
+}
@@ -0,0 +1,230 @@
+/*
+  ==============================================================================
+
+    PipelineTest.h
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace sauna {
+
+// Output of the pipeline against the chain for one stage order, and how fast
+// each of them got through the signal
+struct PipelineReport
+{
+    juce::String name;
+    juce::int64 numDifferent { 0 };      // Samples that are not bit identical
+    double maxDifference { 0.0 };
+    double chainRealtime { 0.0 };        // Multiples of realtime, one thread runs every stage
+    double pipelineRealtime { 0.0 };     // One thread per stage
+    bool passed { false };
+};
+
+
+// Renders the same stereo signal through ExciterChain::process() one block
+// at a time and through an ExciterPipeline streamed in segments of several
+// blocks, with every stage and every modulation destination on, and
+// requires the two to be bit identical in all six stage orders. The stages
+// run the same code on the same blocks either way, only on other threads,
+// so any difference is a bug in the hand over and not rounding.
+class PipelineTest {
+public:
+    explicit PipelineTest(double sampleRateToUse = 48000.0, double numSeconds = 4.0, juce::int64 seed = 1)
+        : sampleRate(sampleRateToUse),
+          signalLength(static_cast<int>(numSeconds * sampleRateToUse) + blockSize / 3)
+    {
+        createSignal(seed);
+    }
+
+    // No copy semantics
+    PipelineTest(const PipelineTest&) = delete;
+    const PipelineTest& operator=(const PipelineTest&) = delete;
+
+    std::vector<PipelineReport> run()
+    {
+        std::vector<PipelineReport> reports;
+
+        for (int order = 0; order < numStageOrders; order++) {
+            reports.push_back(testStageOrder(static_cast<StageOrder>(order)));
+        }
+
+        return reports;
+    }
+
+    static bool allPassed(const std::vector<PipelineReport>& reports)
+    {
+        return std::all_of(reports.begin(), reports.end(), [] (const auto& report) { return report.passed; });
+    }
+
+    // One row per stage order: the difference and the throughput with one
+    // thread and with a thread per stage
+    juce::String createTable(const std::vector<PipelineReport>& reports) const
+    {
+        const auto stageThreads = juce::String(numChainStages) + " threads";
+
+        juce::String table;
+        table << juce::String("Stage order").paddedRight(' ', 30)
+              << juce::String("Different").paddedLeft(' ', 11)
+              << juce::String("Max diff").paddedLeft(' ', 12)
+              << juce::String("1 thread").paddedLeft(' ', 11)
+              << stageThreads.paddedLeft(' ', 11)
+              << juce::String("Speedup").paddedLeft(' ', 9)
+              << "  Result\n";
+
+        for (const auto& report : reports) {
+            const auto speedup = report.chainRealtime > 0.0 ? report.pipelineRealtime / report.chainRealtime : 0.0;
+
+            table << report.name.paddedRight(' ', 30)
+                  << juce::String(report.numDifferent).paddedLeft(' ', 11)
+                  << juce::String(report.maxDifference, 7).paddedLeft(' ', 12)
+                  << (juce::String(report.chainRealtime, 1) + "x").paddedLeft(' ', 11)
+                  << (juce::String(report.pipelineRealtime, 1) + "x").paddedLeft(' ', 11)
+                  << (juce::String(speedup, 2) + "x").paddedLeft(' ', 9)
+                  << (report.passed ? "  pass\n" : "  FAIL\n");
+        }
+
+        table << "Throughput in multiples of realtime at " << juce::String(sampleRate, 0) << " Hz\n";
+        return table;
+    }
+
+private:
+    static constexpr int numChannels = 2;
+    static constexpr int blockSize = 512;
+    static constexpr int blocksPerSegment = 16;
+    static constexpr juce::uint64 sizzleSeed = 0x5a17;
+
+    PipelineReport testStageOrder(StageOrder order)
+    {
+        PipelineReport report;
+        report.name = getStageOrderName(order);
+
+        // Serial, the way the plugin renders a block
+        juce::AudioBuffer<float> chainOutput (signal);
+        {
+            ExciterChain<float> chain;
+            configure(chain, order);
+
+            const auto startMs = juce::Time::getMillisecondCounterHiRes();
+
+            for (int start = 0; start < signalLength; start += blockSize) {
+                const auto numSamples = std::min(blockSize, signalLength - start);
+                juce::dsp::AudioBlock<float> block (chainOutput);
+                auto subBlock = block.getSubBlock(static_cast<size_t>(start), static_cast<size_t>(numSamples));
+                chain.process(juce::dsp::ProcessContextReplacing<float>(subBlock));
+            }
+
+            report.chainRealtime = getRealtimeMultiple(juce::Time::getMillisecondCounterHiRes() - startMs);
+        }
+
+        // Pipelined, in segments of whole blocks so both see the same blocks
+        juce::AudioBuffer<float> pipelineOutput (signal);
+        {
+            ExciterChain<float> chain;
+            configure(chain, order);
+
+            ExciterPipeline<float> pipeline (chain);
+            pipeline.prepare(blockSize);
+
+            const auto startMs = juce::Time::getMillisecondCounterHiRes();
+            const auto segmentSize = blocksPerSegment * blockSize;
+
+            for (int start = 0; start < signalLength; start += segmentSize) {
+                float* channels[numChannels];
+
+                for (int channel = 0; channel < numChannels; channel++) {
+                    channels[channel] = pipelineOutput.getWritePointer(channel, start);
+                }
+
+                pipeline.process(channels, numChannels, std::min(segmentSize, signalLength - start));
+            }
+
+            report.pipelineRealtime = getRealtimeMultiple(juce::Time::getMillisecondCounterHiRes() - startMs);
+            pipeline.release();
+        }
+
+        for (int channel = 0; channel < numChannels; channel++) {
+            const auto* expected = chainOutput.getReadPointer(channel);
+            const auto* actual = pipelineOutput.getReadPointer(channel);
+
+            for (int i = 0; i < signalLength; i++) {
+                if (std::memcmp(expected + i, actual + i, sizeof(float)) != 0) {
+                    report.numDifferent++;
+                    report.maxDifference = std::max(report.maxDifference, std::abs(static_cast<double>(expected[i]) - actual[i]));
+                }
+            }
+        }
+
+        report.passed = report.numDifferent == 0;
+        return report;
+    }
+
+    // The offline quality with every stage audible and both sources routed
+    // to every destination, the LFO fast enough to move within a block
+    void configure(ExciterChain<float>& chain, StageOrder order) const
+    {
+        const auto settings = getQualitySettings(QualityTier::Offline);
+        chain.saturatorProcessor.setOversamplingOrder(settings.oversamplingOrder);
+        chain.saturatorProcessor.saturator.setPrecision(settings.saturatorPrecision);
+        chain.steamerReverb.setRateDivisor(settings.reverbRateDivisor);
+        chain.steamerProcessor.sizzle.setMaxGrains(settings.maxSizzleGrains);
+
+        juce::Reverb::Parameters reverbParams { 0.5f, 0.5f, 0.5f, 0.4f, 1.0f, 0.0f };
+        chain.steamerReverb.setParameters(reverbParams);
+        chain.setRoomSize(reverbParams.roomSize);
+
+        juce::dsp::ProcessSpec spec;
+        spec.sampleRate = sampleRate;
+        spec.maximumBlockSize = static_cast<juce::uint32>(blockSize);
+        spec.numChannels = static_cast<juce::uint32>(numChannels);
+        chain.prepare(spec);
+
+        chain.setStageOrder(order);
+        chain.steamerProcessor.steamer.setGain(-18.0f);
+        chain.steamerProcessor.sizzle.setSeed(sizzleSeed);
+        chain.steamerProcessor.sizzle.setDensity(400.0f);
+        chain.steamerProcessor.sizzle.setGain(-12.0f);
+
+        chain.modulation.setLfoRate(40.0f);
+
+        for (int destination = 0; destination < numModulationDestinations; destination++) {
+            chain.modulation.setDepth(ModulationSource::Lfo, static_cast<ModulationDestination>(destination), 0.5f);
+            chain.modulation.setDepth(ModulationSource::Envelope, static_cast<ModulationDestination>(destination), 0.5f);
+        }
+    }
+
+    // Seeded noise and a stereo tone under an envelope that swells and
+    // drops out, so the envelope follower and the reverb tail both move
+    void createSignal(juce::int64 seed)
+    {
+        signal.setSize(numChannels, signalLength);
+        juce::Random random (seed);
+
+        const auto toneStep = juce::MathConstants<double>::twoPi * 220.0 / sampleRate;
+        const auto swellStep = juce::MathConstants<double>::twoPi * 0.75 / sampleRate;
+
+        for (int i = 0; i < signalLength; i++) {
+            const auto swell = std::max(0.0, std::sin(swellStep * i));
+
+            for (int channel = 0; channel < numChannels; channel++) {
+                const auto tone = std::sin(toneStep * (channel + 1) * i);
+                const auto noise = 2.0 * random.nextDouble() - 1.0;
+                signal.setSample(channel, i, static_cast<float>(swell * (0.5 * tone + 0.1 * noise)));
+            }
+        }
+    }
+
+    double getRealtimeMultiple(double elapsedMs) const
+    {
+        return elapsedMs > 0.0 ? 1000.0 * signalLength / sampleRate / elapsedMs : 0.0;
+    }
+
+    double sampleRate;
+    int signalLength;
+    juce::AudioBuffer<float> signal;
+};
+
+} // end sauna namespace
@@ -0,0 +1,282 @@
+#pragma once
+
+namespace sauna {
+
+// Processing stages of the exciter chain
+enum class ChainStage
+{
+    Steamer = 0,
+    SteamerReverb,
+    Saturator
+};
+
+// Every order the three stages can run in
+enum class StageOrder
+{
+    SteamReverbSaturate = 0,
+    SteamSaturateReverb,
+    ReverbSteamSaturate,
+    ReverbSaturateSteam,
+    SaturateSteamReverb,
+    SaturateReverbSteam
+};
+
+constexpr int numChainStages = 3;
+constexpr int numStageOrders = 6;
+
+inline const char* getStageOrderName(StageOrder order)
+{
+    switch (order) {
+        case StageOrder::SteamReverbSaturate: return "Steam > Reverb > Saturate";
+        case StageOrder::SteamSaturateReverb: return "Steam > Saturate > Reverb";
+        case StageOrder::ReverbSteamSaturate: return "Reverb > Steam > Saturate";
+        case StageOrder::ReverbSaturateSteam: return "Reverb > Saturate > Steam";
+        case StageOrder::SaturateSteamReverb: return "Saturate > Steam > Reverb";
+        case StageOrder::SaturateReverbSteam: return "Saturate > Reverb > Steam";
+    }
+
+    return "Unknown";
+}
+
+
+// Modulation of one block as the stages see it. The chain points it at its
+// matrix, the pipeline at the copy that travels with each block.
+template <typename SampleType>
+struct StageModulation
+{
+    const SampleType* preGain[2] { nullptr, nullptr };
+    const SampleType* steamGain[2] { nullptr, nullptr };
+    const SampleType* sizzleDensity[2] { nullptr, nullptr };
+
+    // Room size targets at the control ticks of the block
+    bool roomSizeModulated { false };
+    int numTicks { 0 };
+    const int* tickPositions { nullptr };
+    const SampleType* roomSizeTicks { nullptr };
+};
+
+
+// The Steamer, SteamerReverb and Saturator stages as one juce::dsp style
+// processor. Every stage allocates in prepare(), each of them runs over the
+// whole block in the order picked from a fixed routing table, so changing
+// the order is a single atomic store and never allocates. The modulation
+// matrix runs on the input of the chain before any stage.
+template <typename SampleType>
+class ExciterChain {
+public:
+    ExciterChain() {}
+    ~ExciterChain() {}
+
+    // No copy semantics
+    ExciterChain(const ExciterChain&) = delete;
+    const ExciterChain& operator=(const ExciterChain&) = delete;
+
+    // No move semantics
+    ExciterChain(ExciterChain&&) = delete;
+    const ExciterChain& operator=(ExciterChain&&) = delete;
+
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        modulation.prepare(spec);
+        steamerProcessor.prepare(spec);
+        steamerReverb.prepare(spec);
+        saturatorProcessor.prepare(spec);
+    }
+
+    void reset()
+    {
+        modulation.reset();
+        steamerProcessor.reset();
+        steamerReverb.reset();
+        saturatorProcessor.reset();
+    }
+
+    // Safe to call from any thread, the new order is picked up at the start
+    // of the next block
+    void setStageOrder(StageOrder order)
+    {
+        const auto index = static_cast<int>(order);
+        jassert(index >= 0 && index < numStageOrders);
+        orderIndex.store(juce::jlimit(0, numStageOrders - 1, index), std::memory_order_relaxed);
+    }
+
+    StageOrder getStageOrder() const { return static_cast<StageOrder>(orderIndex.load(std::memory_order_relaxed)); }
+
+    static ChainStage getStage(StageOrder order, int position)
+    {
+        jassert(position >= 0 && position < numChainStages);
+        return routingTable[static_cast<int>(order)][position];
+    }
+
+    // Lines the LFO, the steam noise and the sizzle grains of a freshly
+    // reset chain up with a render that started numSamples samples earlier.
+    // The sizzle seed has to be the one of that render too.
+    void setPosition(juce::int64 numSamples, int numChannels, juce::uint64 sizzleSeed)
+    {
+        modulation.setPosition(numSamples);
+        steamerProcessor.steamer.setNoisePosition(numSamples, numChannels);
+        steamerProcessor.sizzle.setSeed(sizzleSeed);
+        steamerProcessor.sizzle.setPosition(numSamples);
+    }
+
+    // Unmodulated room size, the reverb gets the modulated one at every
+    // control tick
+    void setRoomSize(float newRoomSize) { roomSize = newRoomSize; }
+
+   #if SAUNA_ENABLE_PROFILING
+    void setProfiler(StageProfiler* profilerToUse) { profiler = profilerToUse; }
+   #endif
+
+    template <typename ProcessContext>
+    void process(const ProcessContext& context)
+    {
+        const auto& inputBlock = context.getInputBlock();
+        auto& outputBlock = context.getOutputBlock();
+
+        if (context.usesSeparateInputAndOutputBlocks()) {
+            outputBlock.copyFrom(inputBlock);
+        }
+
+        modulation.process(outputBlock);
+
+        const juce::dsp::ProcessContextReplacing<SampleType> replacing(outputBlock);
+        const auto blockModulation = getBlockModulation();
+        const auto& route = routingTable[orderIndex.load(std::memory_order_relaxed)];
+
+        for (auto stage : route) {
+            processStage(stage, replacing, blockModulation);
+        }
+    }
+
+    // What the matrix computed for the last block it processed
+    StageModulation<SampleType> getBlockModulation() const
+    {
+        StageModulation<SampleType> blockModulation;
+
+        for (int channel = 0; channel < 2; channel++) {
+            blockModulation.preGain[channel] = modulation.getRamp(ModulationDestination::PreGain, channel);
+            blockModulation.steamGain[channel] = modulation.getRamp(ModulationDestination::SteamGain, channel);
+            blockModulation.sizzleDensity[channel] = modulation.getRamp(ModulationDestination::SizzleDensity, channel);
+        }
+
+        blockModulation.roomSizeModulated = modulation.isModulated(ModulationDestination::RoomSize);
+        blockModulation.numTicks = modulation.getNumTicks();
+        blockModulation.tickPositions = modulation.getTickPositions();
+        blockModulation.roomSizeTicks = modulation.getTickValues(ModulationDestination::RoomSize);
+        return blockModulation;
+    }
+
+    // Runs a single stage, for callers that schedule the stages themselves.
+    // Different stages may run on different threads as long as each one only
+    // ever runs on one at a time.
+    void processStage(ChainStage stage,
+                      const juce::dsp::ProcessContextReplacing<SampleType>& context,
+                      const StageModulation<SampleType>& blockModulation)
+    {
+       #if SAUNA_ENABLE_PROFILING
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+       #endif
+
+        switch (stage) {
+            case ChainStage::Steamer:
+                steamerProcessor.setModulation(blockModulation.steamGain[0], blockModulation.steamGain[1]);
+                steamerProcessor.setSizzleModulation(blockModulation.sizzleDensity[0], blockModulation.sizzleDensity[1]);
+                steamerProcessor.process(context);
+                break;
+
+            case ChainStage::SteamerReverb:
+                processReverb(context, blockModulation);
+                break;
+
+            case ChainStage::Saturator:
+                saturatorProcessor.setPreGainModulation(blockModulation.preGain[0], blockModulation.preGain[1]);
+                saturatorProcessor.process(context);
+                break;
+        }
+
+       #if SAUNA_ENABLE_PROFILING
+        if (profiler != nullptr) {
+            profiler->addStageTicks(getProfileStage(stage), juce::Time::getHighResolutionTicks() - startTicks);
+        }
+       #endif
+    }
+
+    ModulationMatrix<SampleType> modulation;
+    SteamerProcessor<SampleType> steamerProcessor;
+    SteamerReverb<SampleType> steamerReverb;
+    SaturatorProcessor<SampleType> saturatorProcessor;
+
+private:
+    // The reverb coefficients are only recomputed at the control ticks, it
+    // smooths them itself in between
+    void processReverb(const juce::dsp::ProcessContextReplacing<SampleType>& context,
+                       const StageModulation<SampleType>& blockModulation)
+    {
+        // Unmodulated, the whole block goes through in one go
+        if (! blockModulation.roomSizeModulated) {
+            updateRoomSize(1);
+            steamerReverb.process(context);
+            return;
+        }
+
+        auto& block = context.getOutputBlock();
+        const auto numSamples = static_cast<int>(block.getNumSamples());
+        const auto numTicks = blockModulation.numTicks;
+        int start = 0;
+
+        for (int tick = 0; tick <= numTicks; tick++) {
+            const auto end = tick < numTicks ? blockModulation.tickPositions[tick] : numSamples;
+
+            if (end > start) {
+                auto subBlock = block.getSubBlock(static_cast<size_t>(start), static_cast<size_t>(end - start));
+                steamerReverb.process(juce::dsp::ProcessContextReplacing<SampleType>(subBlock));
+                start = end;
+            }
+
+            if (tick < numTicks) {
+                updateRoomSize(blockModulation.roomSizeTicks[tick]);
+            }
+        }
+    }
+
+    void updateRoomSize(SampleType scale)
+    {
+        const auto modulatedRoomSize = roomSize * static_cast<float>(scale);
+        auto parameters = steamerReverb.getParameters();
+
+        if (parameters.roomSize != modulatedRoomSize) {
+            parameters.roomSize = modulatedRoomSize;
+            steamerReverb.setParameters(parameters);
+        }
+    }
+
+   #if SAUNA_ENABLE_PROFILING
+    static ProfileStage getProfileStage(ChainStage stage)
+    {
+        switch (stage) {
+            case ChainStage::Steamer:       return ProfileStage::Steamer;
+            case ChainStage::SteamerReverb: return ProfileStage::SteamerReverb;
+            case ChainStage::Saturator:     return ProfileStage::Saturator;
+        }
+
+        return ProfileStage::Steamer;
+    }
+
+    StageProfiler* profiler { nullptr };
+   #endif
+
+    // Indexed by StageOrder
+    static constexpr ChainStage routingTable[numStageOrders][numChainStages] {
+        { ChainStage::Steamer,       ChainStage::SteamerReverb, ChainStage::Saturator },
+        { ChainStage::Steamer,       ChainStage::Saturator,     ChainStage::SteamerReverb },
+        { ChainStage::SteamerReverb, ChainStage::Steamer,       ChainStage::Saturator },
+        { ChainStage::SteamerReverb, ChainStage::Saturator,     ChainStage::Steamer },
+        { ChainStage::Saturator,     ChainStage::Steamer,       ChainStage::SteamerReverb },
+        { ChainStage::Saturator,     ChainStage::SteamerReverb, ChainStage::Steamer }
+    };
+
+    std::atomic<int> orderIndex { static_cast<int>(StageOrder::SteamReverbSaturate) };
+    float roomSize { 0.5f };
+};
+
+} // end sauna namespace
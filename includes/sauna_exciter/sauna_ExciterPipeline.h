@@ -0,0 +1,297 @@
+#pragma once
+
+namespace sauna {
+
+// Runs the stages of an ExciterChain on a thread each for offline rendering.
+// The signal is cut into fixed size blocks that travel through the stages
+// in the chain's order, handed from one stage to the next through single
+// producer single consumer AbstractFifos, so while the last stage works on
+// one block the first is already on a later one. The calling thread feeds
+// the first stage, runs the modulation matrix and collects the finished
+// blocks. Each block carries its own copy of the modulation because the
+// matrix is a block or two ahead of the later stages.
+//
+// The output is the same as ExciterChain::process() on the same blocks.
+// Throughput grows with the number of stages until the slowest stage is
+// busy all the time, which with oversampling is usually the saturator.
+template <typename SampleType>
+class ExciterPipeline {
+public:
+    explicit ExciterPipeline(ExciterChain<SampleType>& chainToRun) : chain(chainToRun) {}
+
+    ~ExciterPipeline()
+    {
+        stopWorkers();
+    }
+
+    // No copy semantics
+    ExciterPipeline(const ExciterPipeline&) = delete;
+    const ExciterPipeline& operator=(const ExciterPipeline&) = delete;
+
+    // No move semantics
+    ExciterPipeline(ExciterPipeline&&) = delete;
+    const ExciterPipeline& operator=(ExciterPipeline&&) = delete;
+
+    // Allocates the blocks in flight and starts the workers. The chain has
+    // to be prepared for at least newBlockSize samples.
+    void prepare(int newBlockSize, int newNumBlocksInFlight = 8)
+    {
+        stopWorkers();
+
+        blockSize = std::max(newBlockSize, 1);
+        numBlocksInFlight = std::max(newNumBlocksInFlight, numChainStages);
+        blocks.resize(static_cast<size_t>(numBlocksInFlight));
+
+        for (auto& block : blocks) {
+            block.audio.setSize(maxChannels, blockSize);
+            block.ramps.setSize(3 * maxChannels, blockSize);
+            block.tickPositions.assign(static_cast<size_t>(blockSize + 1), 0);
+            block.roomSizeTicks.assign(static_cast<size_t>(blockSize + 1), 0);
+        }
+
+        for (auto& queue : queues) {
+            queue.prepare(numBlocksInFlight);
+        }
+
+        freeBlocks.clear();
+        freeBlocks.reserve(static_cast<size_t>(numBlocksInFlight));
+
+        for (int position = 0; position < numChainStages; position++) {
+            workers[position] = std::make_unique<StageWorker>(*this, position);
+            workers[position]->startThread();
+        }
+    }
+
+    void release()
+    {
+        stopWorkers();
+        blocks.clear();
+    }
+
+    // Renders one or two channels in place and returns once every sample is
+    // out of the last stage. The chain keeps its state between calls, so a
+    // long file can be streamed through in segments. Waits on the workers,
+    // never call it from the audio thread.
+    void process(SampleType* const* channels, int numChannels, int numSamples)
+    {
+        // If you hit this assertion prepare() has not been called
+        jassert(workers[0] != nullptr);
+        jassert(numChannels > 0 && numChannels <= maxChannels);
+        numChannels = juce::jlimit(1, maxChannels, numChannels);
+
+        // Stage order is fixed for the whole call, the workers read it after
+        // the first block is handed to them
+        const auto order = chain.getStageOrder();
+
+        for (int position = 0; position < numChainStages; position++) {
+            route[position] = ExciterChain<SampleType>::getStage(order, position);
+        }
+
+        freeBlocks.clear();
+
+        for (int index = numBlocksInFlight - 1; index >= 0; index--) {
+            freeBlocks.push_back(index);
+        }
+
+        auto& finished = queues[numChainStages];
+        int numSubmitted = 0;
+        int numCollected = 0;
+
+        while (numCollected < numSamples) {
+            auto progressed = false;
+
+            while (! freeBlocks.empty() && numSubmitted < numSamples) {
+                const auto index = freeBlocks.back();
+                freeBlocks.pop_back();
+
+                const auto length = std::min(blockSize, numSamples - numSubmitted);
+                submitBlock(index, channels, numChannels, numSubmitted, length);
+                numSubmitted += length;
+                progressed = true;
+            }
+
+            for (auto index = finished.pop(); index >= 0; index = finished.pop()) {
+                const auto& block = blocks[static_cast<size_t>(index)];
+
+                for (int channel = 0; channel < numChannels; channel++) {
+                    std::copy_n(block.audio.getReadPointer(channel), block.numSamples, channels[channel] + block.startSample);
+                }
+
+                numCollected += block.numSamples;
+                freeBlocks.push_back(index);
+                progressed = true;
+            }
+
+            if (! progressed) {
+                finished.ready.wait(100);
+            }
+        }
+    }
+
+private:
+    static constexpr int maxChannels = 2;
+
+    // One block in flight with the modulation the matrix computed for it
+    struct Block
+    {
+        juce::AudioBuffer<SampleType> audio;
+        juce::AudioBuffer<SampleType> ramps;
+        std::vector<int> tickPositions;
+        std::vector<SampleType> roomSizeTicks;
+        StageModulation<SampleType> modulation;
+        int numChannels { 0 };
+        int startSample { 0 };
+        int numSamples { 0 };
+
+        juce::dsp::AudioBlock<SampleType> getAudioBlock()
+        {
+            return juce::dsp::AudioBlock<SampleType>(audio)
+                .getSubsetChannelBlock(0, static_cast<size_t>(numChannels))
+                .getSubBlock(0, static_cast<size_t>(numSamples));
+        }
+    };
+
+    // Indices of the blocks waiting for a stage, one writer and one reader
+    struct BlockQueue
+    {
+        void prepare(int capacity)
+        {
+            fifo.setTotalSize(capacity + 1);
+            fifo.reset();
+            slots.assign(static_cast<size_t>(capacity + 1), 0);
+        }
+
+        void push(int index)
+        {
+            {
+                const auto scope = fifo.write(1);
+
+                // If you hit this assertion there are more blocks in flight than were prepared
+                jassert(scope.blockSize1 == 1);
+                slots[static_cast<size_t>(scope.startIndex1)] = index;
+            }
+
+            ready.signal();
+        }
+
+        // -1 if the queue is empty
+        int pop()
+        {
+            const auto scope = fifo.read(1);
+            return scope.blockSize1 > 0 ? slots[static_cast<size_t>(scope.startIndex1)] : -1;
+        }
+
+        juce::AbstractFifo fifo { 1 };
+        std::vector<int> slots;
+        juce::WaitableEvent ready;
+    };
+
+    class StageWorker : public juce::Thread {
+    public:
+        StageWorker(ExciterPipeline& owner, int stagePosition)
+            : juce::Thread("Sauna pipeline stage " + juce::String(stagePosition + 1)), pipeline(owner), position(stagePosition) {}
+
+        ~StageWorker() override
+        {
+            stopThread(2000);
+        }
+
+        void run() override
+        {
+            juce::ScopedNoDenormals noDenormals;
+            auto& input = pipeline.queues[position];
+            auto& output = pipeline.queues[position + 1];
+
+            while (! threadShouldExit()) {
+                const auto index = input.pop();
+
+                if (index < 0) {
+                    input.ready.wait(100);
+                    continue;
+                }
+
+                pipeline.processBlock(position, index);
+                output.push(index);
+            }
+        }
+
+    private:
+        ExciterPipeline& pipeline;
+        const int position;
+
+        JUCE_DECLARE_NON_COPYABLE(StageWorker)
+    };
+
+    // Calling thread, copies the input in and runs the modulation over it
+    void submitBlock(int index, SampleType* const* channels, int numChannels, int startSample, int numSamples)
+    {
+        auto& block = blocks[static_cast<size_t>(index)];
+        block.numChannels = numChannels;
+        block.startSample = startSample;
+        block.numSamples = numSamples;
+
+        for (int channel = 0; channel < numChannels; channel++) {
+            std::copy_n(channels[channel] + startSample, numSamples, block.audio.getWritePointer(channel));
+        }
+
+        chain.modulation.process(block.getAudioBlock());
+        const auto modulation = chain.getBlockModulation();
+
+        for (int channel = 0; channel < maxChannels; channel++) {
+            block.ramps.copyFrom(channel, 0, modulation.preGain[channel], numSamples);
+            block.ramps.copyFrom(maxChannels + channel, 0, modulation.steamGain[channel], numSamples);
+            block.ramps.copyFrom(2 * maxChannels + channel, 0, modulation.sizzleDensity[channel], numSamples);
+            block.modulation.preGain[channel] = block.ramps.getReadPointer(channel);
+            block.modulation.steamGain[channel] = block.ramps.getReadPointer(maxChannels + channel);
+            block.modulation.sizzleDensity[channel] = block.ramps.getReadPointer(2 * maxChannels + channel);
+        }
+
+        std::copy_n(modulation.tickPositions, modulation.numTicks, block.tickPositions.begin());
+        std::copy_n(modulation.roomSizeTicks, modulation.numTicks, block.roomSizeTicks.begin());
+        block.modulation.roomSizeModulated = modulation.roomSizeModulated;
+        block.modulation.numTicks = modulation.numTicks;
+        block.modulation.tickPositions = block.tickPositions.data();
+        block.modulation.roomSizeTicks = block.roomSizeTicks.data();
+
+        queues[0].push(index);
+    }
+
+    // Worker threads, each stage of the chain is only touched by one
+    void processBlock(int position, int index)
+    {
+        auto& block = blocks[static_cast<size_t>(index)];
+        auto audioBlock = block.getAudioBlock();
+        chain.processStage(route[position], juce::dsp::ProcessContextReplacing<SampleType>(audioBlock), block.modulation);
+    }
+
+    void stopWorkers()
+    {
+        for (auto& worker : workers) {
+            if (worker != nullptr) {
+                worker->signalThreadShouldExit();
+            }
+        }
+
+        for (auto& queue : queues) {
+            queue.ready.signal();
+        }
+
+        for (auto& worker : workers) {
+            worker.reset();
+        }
+    }
+
+    ExciterChain<SampleType>& chain;
+    ChainStage route[numChainStages] {};
+
+    int blockSize { 0 };
+    int numBlocksInFlight { 0 };
+    std::vector<Block> blocks;
+    std::vector<int> freeBlocks;
+
+    // queues[i] feeds stage i, the last one holds the finished blocks
+    BlockQueue queues[numChainStages + 1];
+    std::unique_ptr<StageWorker> workers[numChainStages];
+};
+
+} // end sauna namespace
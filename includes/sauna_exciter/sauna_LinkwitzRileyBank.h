@@ -0,0 +1,280 @@
+#pragma once
+
+namespace sauna {
+
+constexpr int maxMultibandBands = 4;
+constexpr int numCrossovers = maxMultibandBands - 1;
+
+
+// Splits a signal into up to four bands with 4th order Linkwitz-Riley
+// crossovers. It is juce::dsp::LinkwitzRileyFilter (two TPT state variable
+// filters in series) rewritten so every band runs in its own SIMDRegister
+// lane: each band goes through a cascade of three stages, one per crossover,
+// and each lane picks lowpass, highpass, allpass or through per stage with
+// mix coefficients, so the whole bank is branch free and filters all bands
+// with the instructions of one.
+//
+// Band b is highpassed by the crossovers below it, lowpassed by its own and
+// allpassed by the ones above it, so the bands sum to an allpass.
+//
+// Crossover changes glide over frequencySmoothingTime, the coefficients are
+// recomputed every coefficientInterval samples while they do. The TPT
+// filters stay stable while their cutoff moves.
+template <typename SampleType>
+class LinkwitzRileyBank {
+public:
+    using Vector = juce::dsp::SIMDRegister<SampleType>;
+
+    LinkwitzRileyBank()
+    {
+        const SampleType defaults[numCrossovers] { 150, 1500, 6000 };
+
+        for (int i = 0; i < numCrossovers; i++) {
+            frequencies[i].setCurrentAndTargetValue(defaults[i]);
+        }
+    }
+
+    ~LinkwitzRileyBank() {}
+
+    // No copy semantics
+    LinkwitzRileyBank(const LinkwitzRileyBank&) = delete;
+    const LinkwitzRileyBank& operator=(const LinkwitzRileyBank&) = delete;
+
+    // No move semantics
+    LinkwitzRileyBank(LinkwitzRileyBank&&) = delete;
+    const LinkwitzRileyBank& operator=(LinkwitzRileyBank&&) = delete;
+
+    static constexpr double frequencySmoothingTime = 0.05;
+    static constexpr int coefficientInterval = 32;
+
+    void prepare(double newSampleRate)
+    {
+        sampleRate = newSampleRate;
+
+        for (auto& frequency : frequencies) {
+            frequency.reset(sampleRate, frequencySmoothingTime);
+        }
+
+        reset();
+    }
+
+    // Also jumps to the target crossovers
+    void reset()
+    {
+        for (auto& frequency : frequencies) {
+            frequency.setCurrentAndTargetValue(frequency.getTargetValue());
+        }
+
+        updateCoefficients();
+
+        for (auto& channel : state) {
+            for (auto& vector : channel) {
+                for (auto& stage : vector) {
+                    for (auto& value : stage) {
+                        value = Vector::expand(0);
+                    }
+                }
+            }
+        }
+    }
+
+    // Changing the number of bands moves bands between lanes, so the filters
+    // start again from silence. MultibandSaturator crossfades between two
+    // banks to change it without a click.
+    void setNumBands(int newNumBands)
+    {
+        jassert(newNumBands >= 2 && newNumBands <= maxMultibandBands);
+        newNumBands = juce::jlimit(2, maxMultibandBands, newNumBands);
+
+        if (newNumBands != numBands) {
+            numBands = newNumBands;
+            reset();
+        }
+    }
+
+    int getNumBands() const { return numBands; }
+
+    // Crossovers are expected in ascending order, the bands still sum to an
+    // allpass if they are not. Glides to the new frequency once prepared.
+    void setCrossoverFrequency(int index, float hz)
+    {
+        jassert(index >= 0 && index < numCrossovers);
+        frequencies[index].setTargetValue(std::max(static_cast<SampleType>(hz), minimumFrequency));
+    }
+
+    float getCrossoverFrequency(int index) const { return static_cast<float>(frequencies[index].getTargetValue()); }
+
+    // Splits up to two channels, bands[channel][b] receives numSamples
+    // samples of band b
+    void process(const SampleType* const* input, SampleType* const* const* bands, int numChannels, int numSamples) noexcept
+    {
+        // If you hit this assertion prepare() has not been called
+        jassert(sampleRate > 0.0);
+        numChannels = std::min(numChannels, maxChannels);
+        int length = 0;
+
+        for (int start = 0; start < numSamples; start += length) {
+            length = numSamples - start;
+
+            if (isSmoothing()) {
+                length = std::min(length, coefficientInterval);
+
+                for (auto& frequency : frequencies) {
+                    frequency.skip(length);
+                }
+
+                updateCoefficients();
+            }
+
+            for (int channel = 0; channel < numChannels; channel++) {
+                processChannel(channel, input[channel] + start, bands[channel], start, length);
+            }
+        }
+    }
+
+private:
+    static constexpr size_t lanes = Vector::SIMDNumElements;
+    static constexpr int numVectors = static_cast<int>((maxMultibandBands + lanes - 1) / lanes);
+    static constexpr int maxChannels = 2;
+    static constexpr int scratchLength = 64;
+    static constexpr SampleType minimumFrequency = 10;
+
+    bool isSmoothing() const
+    {
+        return std::any_of(std::begin(frequencies), std::end(frequencies), [] (const auto& frequency) { return frequency.isSmoothing(); });
+    }
+
+    // Writes band b to bands[b] + offset. The output vectors of up to
+    // scratchLength samples are stored whole, then every band is read out of
+    // its lane in one strided pass, which transposes the block.
+    void processChannel(int channel, const SampleType* input, SampleType* const* bands, int offset, int numSamples) noexcept
+    {
+        auto& channelState = state[channel];
+        alignas(Vector::SIMDRegisterSize) SampleType scratch[numVectors][scratchLength * lanes];
+
+        for (int start = 0; start < numSamples; start += scratchLength) {
+            const auto length = static_cast<size_t>(std::min(scratchLength, numSamples - start));
+
+            for (size_t i = 0; i < length; i++) {
+                const auto x = Vector::expand(input[start + static_cast<int>(i)]);
+
+                for (int v = 0; v < numVectors; v++) {
+                    auto y = x;
+
+                    for (int stage = 0; stage < numCrossovers; stage++) {
+                        y = processStage(coefficients[v][stage], channelState[v][stage], y);
+                    }
+
+                    y.copyToRawArray(scratch[v] + i * lanes);
+                }
+            }
+
+            for (int band = 0; band < numBands; band++) {
+                const auto* lane = scratch[static_cast<size_t>(band) / lanes] + static_cast<size_t>(band) % lanes;
+                auto* output = bands[band] + offset + start;
+
+                for (size_t i = 0; i < length; i++) {
+                    output[i] = lane[i * lanes];
+                }
+            }
+        }
+    }
+
+    // Per lane coefficients of one stage, the mixes pick the response
+    struct Stage
+    {
+        Vector g, h, gk;
+        Vector lowpass, highpass, allpass, through;
+    };
+
+    enum class Response
+    {
+        Lowpass,
+        Highpass,
+        Allpass,
+        Through,
+        Silent
+    };
+
+    Response getResponse(int band, int stage) const
+    {
+        if (band >= numBands) {
+            return Response::Silent;
+        }
+
+        if (stage >= numBands - 1) {
+            return Response::Through;
+        }
+
+        if (stage < band) {
+            return Response::Highpass;
+        }
+
+        return stage == band ? Response::Lowpass : Response::Allpass;
+    }
+
+    void updateCoefficients()
+    {
+        if (sampleRate <= 0.0) {
+            return;
+        }
+
+        const auto nyquistLimit = static_cast<SampleType>(0.49 * sampleRate);
+
+        for (int stage = 0; stage < numCrossovers; stage++) {
+            // Same prewarping as juce::dsp::LinkwitzRileyFilter
+            const auto frequency = juce::jlimit(minimumFrequency, nyquistLimit, frequencies[stage].getCurrentValue());
+            const auto g = static_cast<SampleType>(std::tan(juce::MathConstants<double>::pi * frequency / sampleRate));
+            const auto h = 1 / (1 + root2 * g + g * g);
+
+            for (int v = 0; v < numVectors; v++) {
+                auto& c = coefficients[v][stage];
+                c.g = Vector::expand(g);
+                c.h = Vector::expand(h);
+                c.gk = Vector::expand(g + root2);
+
+                for (size_t lane = 0; lane < lanes; lane++) {
+                    const auto response = getResponse(v * static_cast<int>(lanes) + static_cast<int>(lane), stage);
+                    c.lowpass.set(lane, response == Response::Lowpass ? 1 : 0);
+                    c.highpass.set(lane, response == Response::Highpass ? 1 : 0);
+                    c.allpass.set(lane, response == Response::Allpass ? 1 : 0);
+                    c.through.set(lane, response == Response::Through ? 1 : 0);
+                }
+            }
+        }
+    }
+
+    // Two state variable filters in series. The second one is fed the
+    // lowpass or the highpass of the first, the allpass is taken from the
+    // first alone.
+    static Vector processStage(const Stage& c, Vector* s, Vector x) noexcept
+    {
+        const auto root2Vector = Vector::expand(root2);
+
+        const auto hp1 = (x - c.gk * s[0] - s[1]) * c.h;
+        const auto bp1 = c.g * hp1 + s[0];
+        s[0] = c.g * hp1 + bp1;
+        const auto lp1 = c.g * bp1 + s[1];
+        s[1] = c.g * bp1 + lp1;
+
+        const auto x2 = c.lowpass * lp1 + c.highpass * hp1;
+        const auto hp2 = (x2 - c.gk * s[2] - s[3]) * c.h;
+        const auto bp2 = c.g * hp2 + s[2];
+        s[2] = c.g * hp2 + bp2;
+        const auto lp2 = c.g * bp2 + s[3];
+        s[3] = c.g * bp2 + lp2;
+
+        const auto ap = lp1 - root2Vector * bp1 + hp1;
+        return c.lowpass * lp2 + c.highpass * hp2 + c.allpass * ap + c.through * x;
+    }
+
+    static constexpr SampleType root2 = static_cast<SampleType>(1.4142135623730951);
+
+    double sampleRate { 0.0 };
+    int numBands { 2 };
+    juce::SmoothedValue<SampleType, juce::ValueSmoothingTypes::Multiplicative> frequencies[numCrossovers];
+    Stage coefficients[numVectors][numCrossovers];
+    Vector state[maxChannels][numVectors][numCrossovers][4];
+};
+
+} // end sauna namespace
@@ -0,0 +1,343 @@
+#pragma once
+
+namespace sauna {
+
+// Modulation sources, both unipolar in [0, 1]
+enum class ModulationSource
+{
+    Lfo = 0,        // Stereo sine, the right channel is a quarter cycle ahead
+    Envelope        // Peak follower of the input
+};
+
+// Parameters that can be modulated
+enum class ModulationDestination
+{
+    PreGain = 0,
+    SteamGain,
+    RoomSize,
+    SizzleDensity
+};
+
+constexpr int numModulationSources = 2;
+constexpr int numModulationDestinations = 4;
+
+
+// Routes the modulation sources to the destinations. The envelope is
+// evaluated once every control interval and ramped linearly in between. The
+// LFO can run close to the control rate, so it is a rotating phasor stepped
+// every sample instead and is added on top of the ramps with vector
+// operations. Destinations whose coefficients are only recomputed at the
+// ticks read both sources at the tick.
+//
+// A destination scale is 1 + sum(depth * (source - 1)) clamped to [0, 1],
+// so a depth of 0 leaves it alone and a depth of 1 follows the source.
+template <typename SampleType>
+class ModulationMatrix {
+public:
+    ModulationMatrix() {}
+    ~ModulationMatrix() {}
+
+    // No copy semantics
+    ModulationMatrix(const ModulationMatrix&) = delete;
+    const ModulationMatrix& operator=(const ModulationMatrix&) = delete;
+
+    // No move semantics
+    ModulationMatrix(ModulationMatrix&&) = delete;
+    const ModulationMatrix& operator=(ModulationMatrix&&) = delete;
+
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        sampleRate = spec.sampleRate;
+        maximumBlockSize = static_cast<int>(spec.maximumBlockSize);
+
+        ramps.setSize(numModulationDestinations * numChannels, maximumBlockSize);
+        lfoBuffer.setSize(numChannels, maximumBlockSize);
+        allocateTicks();
+        updateCoefficients();
+        reset();
+    }
+
+    void reset()
+    {
+        lfoPhase = 0;
+        envelope = 0;
+        peak = 0;
+        samplesUntilTick = 0;
+        numTicks = 0;
+        firstTick = true;
+    }
+
+    void setDepth(ModulationSource source, ModulationDestination destination, float depth)
+    {
+        depths[static_cast<int>(source)][static_cast<int>(destination)] = juce::jlimit(static_cast<SampleType>(0),
+                                                                                      static_cast<SampleType>(1),
+                                                                                      static_cast<SampleType>(depth));
+    }
+
+    float getDepth(ModulationSource source, ModulationDestination destination) const
+    {
+        return static_cast<float>(depths[static_cast<int>(source)][static_cast<int>(destination)]);
+    }
+
+    // True if any source is routed to the destination
+    bool isModulated(ModulationDestination destination) const
+    {
+        for (int source = 0; source < numModulationSources; source++) {
+            if (depths[source][static_cast<int>(destination)] > 0) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Called every block with the parameter value, only recomputes when it
+    // changed
+    void setLfoRate(float hz)
+    {
+        if (hz == lfoRate) {
+            return;
+        }
+
+        lfoRate = hz;
+        updateCoefficients();
+    }
+
+    void setEnvelopeTimes(float attackMs, float releaseMs)
+    {
+        attackTime = attackMs;
+        releaseTime = releaseMs;
+        updateCoefficients();
+    }
+
+    // Samples between two evaluations of the sources, takes effect at the
+    // next tick. Reallocates, so call it before prepare().
+    void setControlInterval(int numSamples)
+    {
+        jassert(numSamples > 0);
+        controlInterval = std::max(numSamples, 1);
+        allocateTicks();
+        updateCoefficients();
+    }
+
+    int getControlInterval() const { return controlInterval; }
+
+    // Moves the LFO and the control ticks to where they would be numSamples
+    // samples after reset(), the envelope starts from silence. Lets
+    // instances that each render a part of one signal modulate in step, as
+    // long as the LFO rate does not change.
+    void setPosition(juce::int64 numSamples)
+    {
+        jassert(numSamples >= 0);
+        numSamples = std::max<juce::int64>(numSamples, 0);
+
+        const auto numElapsedTicks = (numSamples + controlInterval - 1) / controlInterval;
+        samplesUntilTick = static_cast<int>(numElapsedTicks * controlInterval - numSamples);
+        lfoPhase = std::fmod(static_cast<double>(numSamples) * lfoIncrement, juce::MathConstants<double>::twoPi);
+    }
+
+    // Runs the sources over the input of the chain and fills the ramps for
+    // this block
+    void process(const juce::dsp::AudioBlock<SampleType>& input)
+    {
+        const auto numSamples = static_cast<int>(input.getNumSamples());
+        const auto numInputChannels = std::min(input.getNumChannels(), static_cast<size_t>(numChannels));
+
+        // If you hit this assertion the block is larger than the prepared size
+        jassert(numSamples <= maximumBlockSize);
+
+        renderLfo(numSamples);
+
+        numTicks = 0;
+        int position = 0;
+
+        while (position < numSamples) {
+            if (samplesUntilTick == 0) {
+                tick(position);
+                samplesUntilTick = controlInterval;
+            }
+
+            const auto length = std::min(samplesUntilTick, numSamples - position);
+
+            for (size_t channel = 0; channel < numInputChannels; channel++) {
+                const auto range = juce::FloatVectorOperations::findMinAndMax(input.getChannelPointer(channel) + position, length);
+                peak = std::max(peak, std::max(-range.getStart(), range.getEnd()));
+            }
+
+            for (int destination = 0; destination < numModulationDestinations; destination++) {
+                for (int channel = 0; channel < numChannels; channel++) {
+                    fillRamp(destination, channel, position, length);
+                }
+            }
+
+            position += length;
+            samplesUntilTick -= length;
+        }
+    }
+
+    // Per sample scale of a destination for the current block
+    const SampleType* getRamp(ModulationDestination destination, int channel) const
+    {
+        return ramps.getReadPointer(static_cast<int>(destination) * numChannels + channel);
+    }
+
+    // Ticks that fell into the current block, for destinations whose
+    // coefficients are only recomputed at the ticks
+    int getNumTicks() const { return numTicks; }
+    int getTickPosition(int tickIndex) const { return tickPositions[static_cast<size_t>(tickIndex)]; }
+
+    // Target scale of a destination at a tick, averaged over the channels
+    SampleType getTickValue(ModulationDestination destination, int tickIndex) const
+    {
+        return getTickValues(destination)[tickIndex];
+    }
+
+    // All ticks of the current block at once
+    const int* getTickPositions() const { return tickPositions.data(); }
+
+    const SampleType* getTickValues(ModulationDestination destination) const
+    {
+        return tickValues.data() + static_cast<size_t>(static_cast<int>(destination) * maxTicks);
+    }
+
+    // Most ticks a block of the prepared size can have
+    int getMaxTicks() const { return maxTicks; }
+
+private:
+    static constexpr int numChannels = 2;
+
+    void allocateTicks()
+    {
+        maxTicks = maximumBlockSize / controlInterval + 1;
+        tickPositions.assign(static_cast<size_t>(maxTicks), 0);
+        tickValues.assign(static_cast<size_t>(maxTicks * numModulationDestinations), 0);
+    }
+
+    void updateCoefficients()
+    {
+        if (sampleRate <= 0.0) {
+            return;
+        }
+
+        const auto tickRate = sampleRate / controlInterval;
+        lfoIncrement = juce::MathConstants<double>::twoPi * lfoRate / sampleRate;
+        attackCoefficient = static_cast<SampleType>(std::exp(-1000.0 / (std::max(attackTime, 0.01f) * tickRate)));
+        releaseCoefficient = static_cast<SampleType>(std::exp(-1000.0 / (std::max(releaseTime, 0.01f) * tickRate)));
+    }
+
+    // LFO minus 1 for every sample of the block, so it can be added to the
+    // ramps scaled by its depth. The left channel is 0.5 + 0.5 sin, the
+    // right one a quarter cycle ahead is 0.5 + 0.5 cos of the same phasor.
+    // The phasor starts from the exact phase every block, so it never drifts.
+    void renderLfo(int numSamples)
+    {
+        auto* left = lfoBuffer.getWritePointer(0);
+        auto* right = lfoBuffer.getWritePointer(1);
+        const auto rotationCos = std::cos(lfoIncrement);
+        const auto rotationSin = std::sin(lfoIncrement);
+        auto c = std::cos(lfoPhase);
+        auto s = std::sin(lfoPhase);
+
+        for (int i = 0; i < numSamples; i++) {
+            left[i] = static_cast<SampleType>(0.5 * s - 0.5);
+            right[i] = static_cast<SampleType>(0.5 * c - 0.5);
+
+            const auto nextC = c * rotationCos - s * rotationSin;
+            s = s * rotationCos + c * rotationSin;
+            c = nextC;
+        }
+
+        lfoPhase = std::fmod(lfoPhase + static_cast<double>(numSamples) * lfoIncrement, juce::MathConstants<double>::twoPi);
+    }
+
+    // Evaluates the envelope and sets up the ramps to the new targets, the
+    // ramps only carry the envelope part of each destination
+    void tick(int position)
+    {
+        const auto level = std::min(peak, static_cast<SampleType>(1));
+        const auto coefficient = level > envelope ? attackCoefficient : releaseCoefficient;
+        envelope = level + coefficient * (envelope - level);
+        peak = 0;
+
+        const auto tickIndex = static_cast<size_t>(numTicks);
+        tickPositions[tickIndex] = position;
+
+        const auto lfo = static_cast<int>(ModulationSource::Lfo);
+        const auto envelopeSource = static_cast<int>(ModulationSource::Envelope);
+
+        for (int destination = 0; destination < numModulationDestinations; destination++) {
+            const auto target = depths[envelopeSource][destination] * (envelope - 1);
+            SampleType average = 0;
+
+            for (int channel = 0; channel < numChannels; channel++) {
+                if (firstTick) {
+                    current[destination][channel] = target;
+                }
+
+                step[destination][channel] = (target - current[destination][channel]) / static_cast<SampleType>(controlInterval);
+
+                const auto lfoAtTick = lfoBuffer.getSample(channel, position);
+                average += juce::jlimit(static_cast<SampleType>(0), static_cast<SampleType>(1), 1 + target + depths[lfo][destination] * lfoAtTick);
+            }
+
+            tickValues[static_cast<size_t>(destination * maxTicks) + tickIndex] = average / numChannels;
+        }
+
+        firstTick = false;
+        numTicks++;
+    }
+
+    void fillRamp(int destination, int channel, int position, int length)
+    {
+        auto* ramp = ramps.getWritePointer(destination * numChannels + channel) + position;
+        const auto start = current[destination][channel];
+        const auto increment = step[destination][channel];
+
+        for (int i = 0; i < length; i++) {
+            ramp[i] = 1 + start + increment * static_cast<SampleType>(i + 1);
+        }
+
+        current[destination][channel] = start + increment * static_cast<SampleType>(length);
+
+        const auto lfoDepth = depths[static_cast<int>(ModulationSource::Lfo)][destination];
+
+        if (lfoDepth > 0) {
+            juce::FloatVectorOperations::addWithMultiply(ramp, lfoBuffer.getReadPointer(channel) + position, lfoDepth, length);
+        }
+
+        juce::FloatVectorOperations::clip(ramp, ramp, static_cast<SampleType>(0), static_cast<SampleType>(1), length);
+    }
+
+    double sampleRate { 0.0 };
+    int maximumBlockSize { 0 };
+    int controlInterval { 32 };
+
+    // Sources
+    float lfoRate { 100.0f };
+    float attackTime { 5.0f };
+    float releaseTime { 150.0f };
+    // Double in either precision so hours of samples do not drift
+    double lfoPhase { 0 };
+    double lfoIncrement { 0 };
+    juce::AudioBuffer<SampleType> lfoBuffer;
+    SampleType envelope { 0 };
+    SampleType peak { 0 };
+    SampleType attackCoefficient { 0 };
+    SampleType releaseCoefficient { 0 };
+
+    // Routing and ramps
+    SampleType depths[numModulationSources][numModulationDestinations] {};
+    SampleType current[numModulationDestinations][numChannels] {};
+    SampleType step[numModulationDestinations][numChannels] {};
+    juce::AudioBuffer<SampleType> ramps;
+    int samplesUntilTick { 0 };
+    bool firstTick { true };
+
+    // Ticks of the current block, the values are grouped by destination
+    std::vector<int> tickPositions;
+    std::vector<SampleType> tickValues;
+    int maxTicks { 1 };
+    int numTicks { 0 };
+};
+
+} // end sauna namespace
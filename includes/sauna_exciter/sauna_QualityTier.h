@@ -0,0 +1,42 @@
+#pragma once
+
+namespace sauna {
+
+// Render quality, from cheapest to best sounding
+enum class QualityTier
+{
+    Eco = 0,
+    Realtime,
+    Offline
+};
+
+// Everything a tier controls, applied together. Tiers only trade cost for
+// accuracy, so a session and its bounce sound the same, which is why the
+// colour of the steam noise is not one of them.
+struct QualitySettings
+{
+    size_t oversamplingOrder;   // The saturator runs at 2^order times the sample rate
+    SaturatorPrecision saturatorPrecision;
+    int reverbRateDivisor;      // The reverb runs at sampleRate / divisor
+    int maxSizzleGrains;        // Cap on the sizzle grains sounding at once
+};
+
+inline QualitySettings getQualitySettings(QualityTier tier)
+{
+    switch (tier) {
+        case QualityTier::Eco:
+            return { 0, SaturatorPrecision::Fast, 2, 16 };
+
+        case QualityTier::Realtime:
+            return { 1, SaturatorPrecision::Fast, 1, 32 };
+
+        case QualityTier::Offline:
+            return { 2, SaturatorPrecision::Accurate, 1, maxSizzleGrains };
+    }
+
+    // If you hit this assertion is because you selected an invalid tier
+    jassertfalse;
+    return getQualitySettings(QualityTier::Realtime);
+}
+
+} // end sauna namespace
@@ -0,0 +1,353 @@
+#pragma once
+
+namespace sauna {
+
+// The Freeverb based juce::Reverb, templated on the sample type so the comb
+// and allpass feedback can run in double precision. It takes the same
+// juce::Reverb::Parameters and sounds the same as juce::Reverb.
+// Unlike juce::Reverb nothing is allocated until setSampleRate() is called.
+template <typename SampleType>
+class ReverbCore {
+public:
+    using Parameters = juce::Reverb::Parameters;
+
+    ReverbCore()
+    {
+        setParameters(Parameters());
+    }
+
+    ~ReverbCore() {}
+
+    // No copy semantics
+    ReverbCore(const ReverbCore&) = delete;
+    const ReverbCore& operator=(const ReverbCore&) = delete;
+
+    // No move semantics
+    ReverbCore(ReverbCore&&) = delete;
+    const ReverbCore& operator=(ReverbCore&&) = delete;
+
+    const Parameters& getParameters() const noexcept { return parameters; }
+
+    // Time the tail takes to fall by decayDb, taken from the feedback of the
+    // longest comb. Damping only makes the tail shorter. A frozen reverb
+    // never decays.
+    static double getTailLengthSeconds(const Parameters& params, double decayDb = 60.0)
+    {
+        if (isFrozen(params.freezeMode)) {
+            return std::numeric_limits<double>::infinity();
+        }
+
+        // Longest right channel comb in setSampleRate()
+        const auto longestCombSeconds = (1617.0 + 23.0) / 44100.0;
+        const auto feedbackLevel = juce::jlimit(0.0, 0.999, params.roomSize * 0.28 + 0.7);
+        return longestCombSeconds * decayDb / (-20.0 * std::log10(feedbackLevel));
+    }
+
+    void setParameters(const Parameters& newParams)
+    {
+        const auto wetScaleFactor = static_cast<SampleType>(3.0);
+        const auto dryScaleFactor = static_cast<SampleType>(2.0);
+
+        const auto wet = static_cast<SampleType>(newParams.wetLevel) * wetScaleFactor;
+        const auto width = static_cast<SampleType>(newParams.width);
+        dryGain.setTargetValue(static_cast<SampleType>(newParams.dryLevel) * dryScaleFactor);
+        wetGain1.setTargetValue(static_cast<SampleType>(0.5) * wet * (static_cast<SampleType>(1) + width));
+        wetGain2.setTargetValue(static_cast<SampleType>(0.5) * wet * (static_cast<SampleType>(1) - width));
+
+        gain = isFrozen(newParams.freezeMode) ? static_cast<SampleType>(0) : static_cast<SampleType>(0.015);
+        parameters = newParams;
+        updateDamping();
+    }
+
+    // Allocates the delay lines, call it from prepare
+    void setSampleRate(double sampleRate)
+    {
+        jassert(sampleRate > 0);
+
+        // Tunings at 44100Hz
+        static const short combTunings[] = { 1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617 };
+        static const short allPassTunings[] = { 556, 441, 341, 225 };
+        const int stereoSpread = 23;
+        const int intSampleRate = static_cast<int>(sampleRate);
+
+        for (int i = 0; i < numCombs; i++) {
+            comb[0][i].setSize((intSampleRate * combTunings[i]) / 44100);
+            comb[1][i].setSize((intSampleRate * (combTunings[i] + stereoSpread)) / 44100);
+        }
+
+        for (int i = 0; i < numAllPasses; i++) {
+            allPass[0][i].setSize((intSampleRate * allPassTunings[i]) / 44100);
+            allPass[1][i].setSize((intSampleRate * (allPassTunings[i] + stereoSpread)) / 44100);
+        }
+
+        const double smoothTime = 0.01;
+        damping.reset(sampleRate, smoothTime);
+        feedback.reset(sampleRate, smoothTime);
+        dryGain.reset(sampleRate, smoothTime);
+        wetGain1.reset(sampleRate, smoothTime);
+        wetGain2.reset(sampleRate, smoothTime);
+
+        prepared = true;
+    }
+
+    // Takes over the tail of a reverb running at another sample rate. Every
+    // delay line is resampled by the age of its samples and the parameter
+    // smoothing carries on from where the other one is, so switching rates
+    // continues the tail instead of starting it again from silence.
+    void copyStateFrom(const ReverbCore& other) noexcept
+    {
+        for (int j = 0; j < numChannels; j++) {
+            for (int i = 0; i < numCombs; i++) {
+                comb[j][i].copyStateFrom(other.comb[j][i]);
+            }
+
+            for (int i = 0; i < numAllPasses; i++) {
+                allPass[j][i].copyStateFrom(other.allPass[j][i]);
+            }
+        }
+
+        copySmoothing(damping, other.damping);
+        copySmoothing(feedback, other.feedback);
+        copySmoothing(dryGain, other.dryGain);
+        copySmoothing(wetGain1, other.wetGain1);
+        copySmoothing(wetGain2, other.wetGain2);
+    }
+
+    void reset()
+    {
+        for (int j = 0; j < numChannels; j++) {
+            for (int i = 0; i < numCombs; i++) {
+                comb[j][i].clear();
+            }
+
+            for (int i = 0; i < numAllPasses; i++) {
+                allPass[j][i].clear();
+            }
+        }
+    }
+
+    void processStereo(SampleType* const left, SampleType* const right, const int numSamples) noexcept
+    {
+        // If you hit this assertion setSampleRate() has not been called
+        jassert(prepared);
+
+        if (! prepared) {
+            return;
+        }
+
+        for (int i = 0; i < numSamples; i++) {
+            const auto input = (left[i] + right[i]) * gain;
+            SampleType outL = 0, outR = 0;
+
+            const auto damp = damping.getNextValue();
+            const auto feedbck = feedback.getNextValue();
+
+            // Accumulate the comb filters in parallel
+            for (int j = 0; j < numCombs; j++) {
+                outL += comb[0][j].process(input, damp, feedbck);
+                outR += comb[1][j].process(input, damp, feedbck);
+            }
+
+            // Run the allpass filters in series
+            for (int j = 0; j < numAllPasses; j++) {
+                outL = allPass[0][j].process(outL);
+                outR = allPass[1][j].process(outR);
+            }
+
+            const auto dry = dryGain.getNextValue();
+            const auto wet1 = wetGain1.getNextValue();
+            const auto wet2 = wetGain2.getNextValue();
+
+            left[i] = outL * wet1 + outR * wet2 + left[i] * dry;
+            right[i] = outR * wet1 + outL * wet2 + right[i] * dry;
+        }
+    }
+
+    void processMono(SampleType* const samples, const int numSamples) noexcept
+    {
+        // If you hit this assertion setSampleRate() has not been called
+        jassert(prepared);
+
+        if (! prepared) {
+            return;
+        }
+
+        for (int i = 0; i < numSamples; i++) {
+            const auto input = samples[i] * gain;
+            SampleType output = 0;
+
+            const auto damp = damping.getNextValue();
+            const auto feedbck = feedback.getNextValue();
+
+            for (int j = 0; j < numCombs; j++) {
+                output += comb[0][j].process(input, damp, feedbck);
+            }
+
+            for (int j = 0; j < numAllPasses; j++) {
+                output = allPass[0][j].process(output);
+            }
+
+            const auto dry = dryGain.getNextValue();
+            const auto wet1 = wetGain1.getNextValue();
+
+            samples[i] = output * wet1 + samples[i] * dry;
+        }
+    }
+
+private:
+    static bool isFrozen(const float freezeMode) noexcept { return freezeMode >= 0.5f; }
+
+    void updateDamping() noexcept
+    {
+        const auto roomScaleFactor = static_cast<SampleType>(0.28);
+        const auto roomOffset = static_cast<SampleType>(0.7);
+        const auto dampScaleFactor = static_cast<SampleType>(0.4);
+
+        if (isFrozen(parameters.freezeMode)) {
+            setDamping(0, 1);
+        } else {
+            setDamping(static_cast<SampleType>(parameters.damping) * dampScaleFactor,
+                       static_cast<SampleType>(parameters.roomSize) * roomScaleFactor + roomOffset);
+        }
+    }
+
+    void setDamping(const SampleType dampingToUse, const SampleType roomSizeToUse) noexcept
+    {
+        damping.setTargetValue(dampingToUse);
+        feedback.setTargetValue(roomSizeToUse);
+    }
+
+    static void copySmoothing(juce::SmoothedValue<SampleType>& value, const juce::SmoothedValue<SampleType>& other) noexcept
+    {
+        value.setCurrentAndTargetValue(other.getCurrentValue());
+        value.setTargetValue(other.getTargetValue());
+    }
+
+    // Fills a delay line from one of another length, buffer[index] holds the
+    // oldest sample of both. Sample k of the destination is as old as
+    // position k * otherSize / size of the source, read with linear
+    // interpolation.
+    static void resampleDelayLine(SampleType* buffer, int size, int index,
+                                  const SampleType* otherBuffer, int otherSize, int otherIndex) noexcept
+    {
+        if (size <= 0 || otherSize <= 0) {
+            return;
+        }
+
+        const auto ratio = static_cast<double>(otherSize) / static_cast<double>(size);
+
+        for (int k = 0; k < size; k++) {
+            const auto position = std::min(static_cast<double>(otherSize - 1), k * ratio);
+            const auto whole = static_cast<int>(position);
+            const auto fraction = static_cast<SampleType>(position - whole);
+            const auto a = otherBuffer[(otherIndex + whole) % otherSize];
+            const auto b = otherBuffer[(otherIndex + std::min(whole + 1, otherSize - 1)) % otherSize];
+            buffer[(index + k) % size] = a + fraction * (b - a);
+        }
+    }
+
+    class CombFilter {
+    public:
+        CombFilter() {}
+
+        void setSize(const int size)
+        {
+            if (size != bufferSize) {
+                bufferIndex = 0;
+                buffer.malloc(static_cast<size_t>(size));
+                bufferSize = size;
+            }
+
+            clear();
+        }
+
+        void clear() noexcept
+        {
+            last = 0;
+            buffer.clear(static_cast<size_t>(bufferSize));
+        }
+
+        void copyStateFrom(const CombFilter& other) noexcept
+        {
+            resampleDelayLine(buffer, bufferSize, bufferIndex, other.buffer, other.bufferSize, other.bufferIndex);
+            last = other.last;
+        }
+
+        SampleType process(const SampleType input, const SampleType damp, const SampleType feedbackLevel) noexcept
+        {
+            const auto output = buffer[bufferIndex];
+            last = (output * (static_cast<SampleType>(1) - damp)) + (last * damp);
+            JUCE_UNDENORMALISE(last);
+
+            auto temp = input + (last * feedbackLevel);
+            JUCE_UNDENORMALISE(temp);
+            buffer[bufferIndex] = temp;
+            bufferIndex = (bufferIndex + 1) % bufferSize;
+            return output;
+        }
+
+    private:
+        juce::HeapBlock<SampleType> buffer;
+        int bufferSize { 0 };
+        int bufferIndex { 0 };
+        SampleType last { 0 };
+
+        JUCE_DECLARE_NON_COPYABLE(CombFilter)
+    };
+
+    class AllPassFilter {
+    public:
+        AllPassFilter() {}
+
+        void setSize(const int size)
+        {
+            if (size != bufferSize) {
+                bufferIndex = 0;
+                buffer.malloc(static_cast<size_t>(size));
+                bufferSize = size;
+            }
+
+            clear();
+        }
+
+        void clear() noexcept
+        {
+            buffer.clear(static_cast<size_t>(bufferSize));
+        }
+
+        void copyStateFrom(const AllPassFilter& other) noexcept
+        {
+            resampleDelayLine(buffer, bufferSize, bufferIndex, other.buffer, other.bufferSize, other.bufferIndex);
+        }
+
+        SampleType process(const SampleType input) noexcept
+        {
+            const auto bufferedValue = buffer[bufferIndex];
+            auto temp = input + (bufferedValue * static_cast<SampleType>(0.5));
+            JUCE_UNDENORMALISE(temp);
+            buffer[bufferIndex] = temp;
+            bufferIndex = (bufferIndex + 1) % bufferSize;
+            return bufferedValue - input;
+        }
+
+    private:
+        juce::HeapBlock<SampleType> buffer;
+        int bufferSize { 0 };
+        int bufferIndex { 0 };
+
+        JUCE_DECLARE_NON_COPYABLE(AllPassFilter)
+    };
+
+    enum { numCombs = 8, numAllPasses = 4, numChannels = 2 };
+
+    Parameters parameters;
+    SampleType gain { 0 };
+    bool prepared { false };
+
+    CombFilter comb[numChannels][numCombs];
+    AllPassFilter allPass[numChannels][numAllPasses];
+
+    juce::SmoothedValue<SampleType> damping, feedback, dryGain, wetGain1, wetGain2;
+};
+
+} // end sauna namespace
@@ -0,0 +1,414 @@
+#pragma once
+
+namespace sauna {
+
+// Most grains that can sound at once, the pool is allocated for this many
+constexpr int maxSizzleGrains = 64;
+
+
+// Short bursts of band passed noise, like water hitting hot stones. Grains
+// are started at random at a density set in grains per second and scaled
+// per sample by a modulation ramp, each with its own length, centre
+// frequency, Q, level and pan.
+//
+// The grains live in a pool allocated in prepare(), laid out so that every
+// grain sits in its own SIMDRegister lane: the envelopes and the band pass
+// filters of a whole batch of grains run with the instructions of one, and
+// the cost per sample is the number of active batches. Grains that would go
+// past the cap set with setMaxGrains() are dropped, so a dense sizzle costs
+// at most maxGrains / lanes batches.
+//
+// Whether a grain starts and what it sounds like only depends on the seed,
+// the sample position and the density, so instances rendering parts of one
+// signal with the same seed produce the same grains as a single one. Give
+// every instance that plays at the same time its own seed, or they sizzle in
+// lockstep and add up.
+template <typename SampleType>
+class SizzleGenerator {
+public:
+    using Vector = juce::dsp::SIMDRegister<SampleType>;
+
+    SizzleGenerator() {}
+    ~SizzleGenerator() {}
+
+    // No copy semantics
+    SizzleGenerator(const SizzleGenerator&) = delete;
+    const SizzleGenerator& operator=(const SizzleGenerator&) = delete;
+
+    // No move semantics
+    SizzleGenerator(SizzleGenerator&&) = delete;
+    const SizzleGenerator& operator=(SizzleGenerator&&) = delete;
+
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        sampleRate = spec.sampleRate;
+        batches.resize(static_cast<size_t>(numBatches));
+        noiseTable = getNoiseTable();
+        reset();
+    }
+
+    void reset()
+    {
+        for (auto& batch : batches) {
+            batch = Batch();
+        }
+
+        numActiveGrains = 0;
+        numDroppedGrains = 0;
+        samplePosition = 0;
+    }
+
+    // Grains per second with the modulation at full scale, 0 turns it off
+    void setDensity(float grainsPerSecond) { density = std::max(grainsPerSecond, 0.0f); }
+    float getDensity() const { return density; }
+
+    // Peak level of the loudest grains, only affects the grains started after
+    void setGain(float db) { gain = juce::Decibels::decibelsToGain(static_cast<SampleType>(db)); }
+
+    // Cap on the grains sounding at once, up to maxSizzleGrains. Grains over
+    // a lowered cap are let to finish.
+    void setMaxGrains(int newMaxGrains)
+    {
+        jassert(newMaxGrains >= 0 && newMaxGrains <= maxSizzleGrains);
+        maxGrains = juce::jlimit(0, maxSizzleGrains, newMaxGrains);
+    }
+
+    int getMaxGrains() const { return maxGrains; }
+    int getNumActiveGrains() const { return numActiveGrains; }
+
+    // Grains that were due while the pool was full, since reset()
+    int getNumDroppedGrains() const { return numDroppedGrains; }
+
+    // Picks another grain schedule, takes effect with the next grain. The
+    // seed is hashed into an offset of the sample position, so even
+    // neighbouring seeds give unrelated schedules.
+    void setSeed(juce::uint64 newSeed)
+    {
+        seed = newSeed;
+        seedOffset = mix(newSeed);
+    }
+
+    juce::uint64 getSeed() const { return seed; }
+
+    // Moves the grain schedule to where it would be numSamples samples
+    // after reset(), the grains of a render that started there have to come
+    // from a warm up
+    void setPosition(juce::int64 numSamples)
+    {
+        jassert(numSamples >= 0);
+        samplePosition = static_cast<juce::uint64>(std::max<juce::int64>(numSamples, 0));
+    }
+
+    // Adds the grains to one or two channels, right == left for mono. The
+    // density ramps scale the density per sample, pass nullptr to leave it
+    // unmodulated.
+    void process(SampleType* left,
+                 SampleType* right,
+                 const SampleType* densityLeft,
+                 const SampleType* densityRight,
+                 int numSamples) noexcept
+    {
+        // If you hit this assertion prepare() has not been called
+        jassert(sampleRate > 0.0);
+
+        if (density > 0.0f && maxGrains > 0) {
+            startGrains(densityLeft, densityRight, numSamples);
+        }
+
+        if (numActiveGrains > 0) {
+            renderGrains(left, right, numSamples);
+            releaseFinishedGrains();
+        }
+
+        samplePosition += static_cast<juce::uint64>(numSamples);
+    }
+
+private:
+    static constexpr size_t lanes = Vector::SIMDNumElements;
+    static constexpr int numBatches = static_cast<int>((maxSizzleGrains + lanes - 1) / lanes);
+    static constexpr int scratchLength = 64;
+    static constexpr int noiseTableSize = 8192;
+    static constexpr int noiseTableMask = noiseTableSize - 1;
+    static constexpr juce::int64 noiseTableSeed = 0x5a17;
+
+    // Envelope position a grain is released at, the filter rings on for a
+    // bit after the envelope is over
+    static constexpr double releasePosition = 1.5;
+
+    // One SIMDRegister lane per grain. The envelope runs over x from 0 to
+    // 1, a negative x delays a grain that starts later in the block.
+    struct Batch
+    {
+        Vector x { Vector::expand(0) };
+        Vector increment { Vector::expand(0) };
+        Vector amplitude { Vector::expand(0) };
+
+        // Band pass state variable filter
+        Vector a1 { Vector::expand(0) }, a2 { Vector::expand(0) }, a3 { Vector::expand(0) }, k { Vector::expand(0) };
+        Vector s1 { Vector::expand(0) }, s2 { Vector::expand(0) };
+
+        Vector gainLeft { Vector::expand(0) };
+        Vector gainRight { Vector::expand(0) };
+        int noiseIndex[lanes] {};
+    };
+
+    // Each sample starts a grain with probability density * scale / sampleRate
+    void startGrains(const SampleType* densityLeft, const SampleType* densityRight, int numSamples)
+    {
+        const auto probability = static_cast<double>(density) / sampleRate;
+
+        for (int i = 0; i < numSamples; i++) {
+            const auto hash = mix(samplePosition + seedOffset + static_cast<juce::uint64>(i));
+            auto scale = 1.0;
+
+            if (densityLeft != nullptr && densityRight != nullptr) {
+                scale = 0.5 * static_cast<double>(densityLeft[i] + densityRight[i]);
+            }
+
+            if (toUnit(hash) >= probability * scale) {
+                continue;
+            }
+
+            if (numActiveGrains >= maxGrains) {
+                numDroppedGrains++;
+                continue;
+            }
+
+            startGrain(numActiveGrains++, i, mix(hash));
+        }
+    }
+
+    // Length, pitch, Q, level and pan are all taken from one hash
+    void startGrain(int grain, int offset, juce::uint64 hash)
+    {
+        const auto unit = [&hash] {
+            hash = mix(hash);
+            return toUnit(hash);
+        };
+
+        const auto lengthSeconds = 0.002 + 0.008 * unit();
+        const auto frequency = std::min(2500.0 * std::pow(4.4, unit()), 0.45 * sampleRate);
+        const auto q = 2.0 + 6.0 * unit();
+        const auto level = 0.25 + 0.75 * unit();
+        const auto pan = unit() * juce::MathConstants<double>::halfPi;
+
+        const auto increment = 1.0 / (lengthSeconds * sampleRate);
+        const auto g = std::tan(juce::MathConstants<double>::pi * frequency / sampleRate);
+        const auto k = 1.0 / q;
+        const auto a1 = 1.0 / (1.0 + g * (g + k));
+
+        auto& batch = batches[static_cast<size_t>(grain) / lanes];
+        const auto lane = static_cast<size_t>(grain) % lanes;
+
+        // 6.75 brings the peak of x (1 - x)^2 up to 1
+        batch.x.set(lane, static_cast<SampleType>(-offset * increment));
+        batch.increment.set(lane, static_cast<SampleType>(increment));
+        batch.amplitude.set(lane, static_cast<SampleType>(6.75 * level) * gain);
+        batch.a1.set(lane, static_cast<SampleType>(a1));
+        batch.a2.set(lane, static_cast<SampleType>(g * a1));
+        batch.a3.set(lane, static_cast<SampleType>(g * g * a1));
+        batch.k.set(lane, static_cast<SampleType>(k));
+        batch.s1.set(lane, 0);
+        batch.s2.set(lane, 0);
+        batch.gainLeft.set(lane, static_cast<SampleType>(std::cos(pan)));
+        batch.gainRight.set(lane, static_cast<SampleType>(std::sin(pan)));
+        batch.noiseIndex[lane] = static_cast<int>(hash >> 40) & noiseTableMask;
+    }
+
+    // Runs scratchLength samples at a time. The noise of every batch is laid
+    // out sample by sample so each sample is one aligned load, and the
+    // batches add their grains into per sample vectors whose lanes are only
+    // summed once all batches are done.
+    void renderGrains(SampleType* left, SampleType* right, int numSamples) noexcept
+    {
+        const auto isMono = left == right;
+        const auto activeBatches = static_cast<int>((static_cast<size_t>(numActiveGrains) + lanes - 1) / lanes);
+        alignas(Vector::SIMDRegisterSize) SampleType noise[scratchLength * lanes];
+        alignas(Vector::SIMDRegisterSize) SampleType sumsLeft[scratchLength * lanes];
+        alignas(Vector::SIMDRegisterSize) SampleType sumsRight[scratchLength * lanes];
+
+        for (int start = 0; start < numSamples; start += scratchLength) {
+            const auto length = static_cast<size_t>(std::min(scratchLength, numSamples - start));
+            std::fill(sumsLeft, sumsLeft + length * lanes, static_cast<SampleType>(0));
+            std::fill(sumsRight, sumsRight + length * lanes, static_cast<SampleType>(0));
+
+            for (int b = 0; b < activeBatches; b++) {
+                auto& batch = batches[static_cast<size_t>(b)];
+
+                for (size_t lane = 0; lane < lanes; lane++) {
+                    const auto index = batch.noiseIndex[lane] + start;
+
+                    for (size_t i = 0; i < length; i++) {
+                        noise[i * lanes + lane] = noiseTable[(index + static_cast<int>(i)) & noiseTableMask];
+                    }
+                }
+
+                renderBatch(batch, noise, sumsLeft, isMono ? nullptr : sumsRight, length);
+            }
+
+            // Lane by lane, which transposes the sums back into samples
+            for (size_t lane = 0; lane < lanes; lane++) {
+                for (size_t i = 0; i < length; i++) {
+                    left[static_cast<size_t>(start) + i] += sumsLeft[i * lanes + lane];
+                }
+
+                if (! isMono) {
+                    for (size_t i = 0; i < length; i++) {
+                        right[static_cast<size_t>(start) + i] += sumsRight[i * lanes + lane];
+                    }
+                }
+            }
+        }
+
+        for (int b = 0; b < activeBatches; b++) {
+            for (auto& index : batches[static_cast<size_t>(b)].noiseIndex) {
+                index = (index + numSamples) & noiseTableMask;
+            }
+        }
+    }
+
+    // Adds the grains of one batch to the sums, panned unless sumsRight is
+    // nullptr
+    static void renderBatch(Batch& batch, const SampleType* noise, SampleType* sumsLeft, SampleType* sumsRight, size_t numSamples) noexcept
+    {
+        const auto zero = Vector::expand(0);
+        const auto one = Vector::expand(1);
+        auto x = batch.x;
+        auto s1 = batch.s1;
+        auto s2 = batch.s2;
+
+        for (size_t i = 0; i < numSamples; i++) {
+            // Fast attack, slow decay, silent outside of [0, 1]
+            const auto position = Vector::max(zero, Vector::min(one, x));
+            const auto remaining = one - position;
+            const auto input = Vector::fromRawArray(noise + i * lanes) * batch.amplitude * position * remaining * remaining;
+
+            const auto v3 = input - s2;
+            const auto v1 = batch.a1 * s1 + batch.a2 * v3;
+            const auto v2 = s2 + batch.a2 * s1 + batch.a3 * v3;
+            s1 = v1 * static_cast<SampleType>(2) - s1;
+            s2 = v2 * static_cast<SampleType>(2) - s2;
+
+            // Unity gain at the centre frequency
+            const auto band = batch.k * v1;
+            auto* sumLeft = sumsLeft + i * lanes;
+
+            if (sumsRight == nullptr) {
+                (Vector::fromRawArray(sumLeft) + band).copyToRawArray(sumLeft);
+            } else {
+                auto* sumRight = sumsRight + i * lanes;
+                (Vector::fromRawArray(sumLeft) + band * batch.gainLeft).copyToRawArray(sumLeft);
+                (Vector::fromRawArray(sumRight) + band * batch.gainRight).copyToRawArray(sumRight);
+            }
+
+            x += batch.increment;
+        }
+
+        batch.x = x;
+        batch.s1 = s1;
+        batch.s2 = s2;
+    }
+
+    // Moves the last active grain into the place of every finished one, so
+    // the active grains stay packed into the first batches
+    void releaseFinishedGrains()
+    {
+        for (int grain = numActiveGrains - 1; grain >= 0; grain--) {
+            if (getLane(grain).x < static_cast<SampleType>(releasePosition)) {
+                continue;
+            }
+
+            const auto last = --numActiveGrains;
+
+            if (grain != last) {
+                setLane(grain, getLane(last));
+            }
+
+            setLane(last, Grain());
+        }
+    }
+
+    // A single lane of a batch
+    struct Grain
+    {
+        SampleType x {}, increment {}, amplitude {};
+        SampleType a1 {}, a2 {}, a3 {}, k {}, s1 {}, s2 {};
+        SampleType gainLeft {}, gainRight {};
+        int noiseIndex {};
+    };
+
+    Grain getLane(int grain) const
+    {
+        const auto& b = batches[static_cast<size_t>(grain) / lanes];
+        const auto lane = static_cast<size_t>(grain) % lanes;
+        return { b.x.get(lane), b.increment.get(lane), b.amplitude.get(lane),
+                 b.a1.get(lane), b.a2.get(lane), b.a3.get(lane), b.k.get(lane), b.s1.get(lane), b.s2.get(lane),
+                 b.gainLeft.get(lane), b.gainRight.get(lane), b.noiseIndex[lane] };
+    }
+
+    void setLane(int grain, const Grain& g)
+    {
+        auto& b = batches[static_cast<size_t>(grain) / lanes];
+        const auto lane = static_cast<size_t>(grain) % lanes;
+        b.x.set(lane, g.x);
+        b.increment.set(lane, g.increment);
+        b.amplitude.set(lane, g.amplitude);
+        b.a1.set(lane, g.a1);
+        b.a2.set(lane, g.a2);
+        b.a3.set(lane, g.a3);
+        b.k.set(lane, g.k);
+        b.s1.set(lane, g.s1);
+        b.s2.set(lane, g.s2);
+        b.gainLeft.set(lane, g.gainLeft);
+        b.gainRight.set(lane, g.gainRight);
+        b.noiseIndex[lane] = g.noiseIndex;
+    }
+
+    // Every grain reads the table from its own offset, so one table built on
+    // first use is shared by all instances
+    static const SampleType* getNoiseTable()
+    {
+        static const auto table = [] {
+            juce::Random random(noiseTableSeed);
+            std::vector<SampleType> values(static_cast<size_t>(noiseTableSize));
+
+            for (auto& value : values) {
+                value = static_cast<SampleType>(random.nextFloat() * 2.0f - 1.0f);
+            }
+
+            return values;
+        }();
+
+        return table.data();
+    }
+
+    // splitmix64 finaliser
+    static juce::uint64 mix(juce::uint64 value) noexcept
+    {
+        value += 0x9e3779b97f4a7c15ULL;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+        return value ^ (value >> 31);
+    }
+
+    // Uniform in [0, 1)
+    static double toUnit(juce::uint64 value) noexcept
+    {
+        return static_cast<double>(value >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    double sampleRate { 0.0 };
+    float density { 0.0f };
+    SampleType gain { 1 };
+    int maxGrains { maxSizzleGrains };
+
+    std::vector<Batch> batches;
+    const SampleType* noiseTable { nullptr };
+    juce::uint64 seed { 0 };
+    juce::uint64 seedOffset { mix(0) };
+    int numActiveGrains { 0 };
+    int numDroppedGrains { 0 };
+    juce::uint64 samplePosition { 0 };
+};
+
+} // end sauna namespace
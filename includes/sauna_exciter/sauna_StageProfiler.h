@@ -0,0 +1,455 @@
+#pragma once
+
+namespace sauna {
+
+// Stages of the exciter chain that can be timed
+enum class ProfileStage
+{
+    ParameterUpdate = 0,
+    Steamer,
+    SteamerReverb,
+    Saturator,
+    numStages
+};
+
+constexpr int numProfileStages = static_cast<int>(ProfileStage::numStages);
+
+inline const char* getProfileStageName(ProfileStage stage)
+{
+    switch (stage) {
+        case ProfileStage::ParameterUpdate: return "ParameterUpdate";
+        case ProfileStage::Steamer:         return "Steamer";
+        case ProfileStage::SteamerReverb:   return "SteamerReverb";
+        case ProfileStage::Saturator:       return "Saturator";
+        default:                            break;
+    }
+
+    return "Unknown";
+}
+
+// Parameter values that were active while a block was processed, so an
+// overload can be traced back to the setting that caused it
+struct ProfileParameters
+{
+    float saturatorPreGainDb { 0.0f };
+    int saturatorType { 0 };
+    float steamerGainDb { 0.0f };
+    float reverbRoomSize { 0.0f };
+    float lfoRate { 0.0f };
+};
+
+// Timings of a single processed block
+struct ProfileBlock
+{
+    juce::int64 blockIndex { 0 };
+    juce::int64 startTicks { 0 };
+    juce::int64 stageTicks[numProfileStages] {};
+    int numSamples { 0 };
+
+    // Stages in the order they first ran in this block, which follows the
+    // chain's StageOrder rather than the order of ProfileStage
+    ProfileStage runOrder[numProfileStages] {};
+    int numStagesRun { 0 };
+    double sampleRate { 0.0 };
+    ProfileParameters parameters;
+
+    juce::int64 getTotalTicks() const noexcept
+    {
+        juce::int64 total = 0;
+
+        for (auto ticks : stageTicks) {
+            total += ticks;
+        }
+
+        return total;
+    }
+
+    double getBudgetSeconds() const noexcept
+    {
+        return sampleRate > 0.0 ? numSamples / sampleRate : 0.0;
+    }
+};
+
+
+// Collects per-stage timings on the audio thread and hands them to a reader
+// thread through a lock-free single producer / single consumer ring buffer.
+// If the reader falls behind, blocks are dropped instead of blocking the
+// audio thread.
+class StageProfiler {
+public:
+    explicit StageProfiler(int capacityInBlocks = 2048)
+        : fifo(capacityInBlocks), blocks(static_cast<size_t>(capacityInBlocks)) {}
+
+    ~StageProfiler() {}
+
+    // No copy semantics
+    StageProfiler(const StageProfiler&) = delete;
+    const StageProfiler& operator=(const StageProfiler&) = delete;
+
+    // No move semantics
+    StageProfiler(StageProfiler&&) = delete;
+    const StageProfiler& operator=(StageProfiler&&) = delete;
+
+    // Audio thread
+    void beginBlock(int numSamples, double sampleRate) noexcept
+    {
+        current = ProfileBlock();
+        current.blockIndex = nextBlockIndex++;
+        current.startTicks = juce::Time::getHighResolutionTicks();
+        current.numSamples = numSamples;
+        current.sampleRate = sampleRate;
+    }
+
+    void setParameters(const ProfileParameters& parameters) noexcept
+    {
+        current.parameters = parameters;
+    }
+
+    void addStageTicks(ProfileStage stage, juce::int64 ticks) noexcept
+    {
+        if (std::find(current.runOrder, current.runOrder + current.numStagesRun, stage) == current.runOrder + current.numStagesRun) {
+            current.runOrder[current.numStagesRun++] = stage;
+        }
+
+        current.stageTicks[static_cast<int>(stage)] += ticks;
+    }
+
+    void endBlock() noexcept
+    {
+        const auto scope = fifo.write(1);
+
+        if (scope.blockSize1 > 0) {
+            blocks[static_cast<size_t>(scope.startIndex1)] = current;
+        } else {
+            droppedBlocks.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Reader thread, returns the number of blocks copied into dest
+    int read(ProfileBlock* dest, int maxBlocks) noexcept
+    {
+        const auto scope = fifo.read(maxBlocks);
+
+        for (int i = 0; i < scope.blockSize1; i++) {
+            dest[i] = blocks[static_cast<size_t>(scope.startIndex1 + i)];
+        }
+
+        for (int i = 0; i < scope.blockSize2; i++) {
+            dest[scope.blockSize1 + i] = blocks[static_cast<size_t>(scope.startIndex2 + i)];
+        }
+
+        return scope.blockSize1 + scope.blockSize2;
+    }
+
+    int getNumDroppedBlocks() const noexcept { return droppedBlocks.load(std::memory_order_relaxed); }
+
+private:
+    juce::AbstractFifo fifo;
+    std::vector<ProfileBlock> blocks;
+    ProfileBlock current;
+    juce::int64 nextBlockIndex { 0 };
+    std::atomic<int> droppedBlocks { 0 };
+};
+
+
+// Adds the time spent in its scope to one stage of the current block
+class ScopedStageTimer {
+public:
+    ScopedStageTimer(StageProfiler& profilerToUse, ProfileStage stageToTime) noexcept
+        : profiler(profilerToUse), stage(stageToTime), startTicks(juce::Time::getHighResolutionTicks()) {}
+
+    ~ScopedStageTimer()
+    {
+        profiler.addStageTicks(stage, juce::Time::getHighResolutionTicks() - startTicks);
+    }
+
+private:
+    StageProfiler& profiler;
+    ProfileStage stage;
+    juce::int64 startTicks;
+
+    JUCE_DECLARE_NON_COPYABLE(ScopedStageTimer)
+};
+
+
+// Background thread that drains a StageProfiler and keeps a log2 histogram
+// of the stage timings. On request it also streams the blocks to a Chrome
+// trace-event JSON file (open it in chrome://tracing or Perfetto), at most
+// maxSeconds of audio per trace since every block adds a few hundred bytes.
+class StageProfileExporter : private juce::Thread {
+public:
+    explicit StageProfileExporter(StageProfiler& profilerToDrain, int processId = 1)
+        : juce::Thread("Sauna profile exporter"), profiler(profilerToDrain), pid(processId)
+    {
+        scratch.resize(256);
+    }
+
+    ~StageProfileExporter() override
+    {
+        stop();
+    }
+
+    void start()
+    {
+        startThread();
+    }
+
+    // Also finishes a running trace
+    void stop()
+    {
+        stopThread(2000);
+        stopTrace();
+    }
+
+    // Replaces the file with a trace of the blocks from now on, until
+    // stopTrace() or maxSeconds of audio have been written. False if the
+    // file cannot be written.
+    bool startTrace(const juce::File& file, double maxSeconds = 60.0)
+    {
+        const juce::ScopedLock sl(traceLock);
+        finishTrace();
+
+        if (! file.deleteFile()) {
+            return false;
+        }
+
+        traceStream = file.createOutputStream();
+
+        if (traceStream == nullptr) {
+            return false;
+        }
+
+        *traceStream << "{\"traceEvents\":[" << juce::newLine;
+        traceFile = file;
+        traceSecondsLeft = maxSeconds;
+        firstEvent = true;
+        return true;
+    }
+
+    void stopTrace()
+    {
+        const juce::ScopedLock sl(traceLock);
+        finishTrace();
+    }
+
+    bool isTracing() const
+    {
+        const juce::ScopedLock sl(traceLock);
+        return traceStream != nullptr;
+    }
+
+    // File of the running or the last trace
+    juce::File getTraceFile() const
+    {
+        const juce::ScopedLock sl(traceLock);
+        return traceFile;
+    }
+
+    // Human readable histogram of every stage, plus the worst block seen
+    juce::String getSummary() const
+    {
+        const juce::ScopedLock sl(summaryLock);
+
+        juce::String summary;
+        summary << "Blocks: " << numBlocks
+                << ", overruns: " << numOverruns
+                << ", dropped: " << profiler.getNumDroppedBlocks() << juce::newLine;
+
+        for (int stage = 0; stage < numProfileStages; stage++) {
+            const auto& s = stages[stage];
+            const auto mean = numBlocks > 0 ? s.totalMicros / static_cast<double>(numBlocks) : 0.0;
+
+            summary << getProfileStageName(static_cast<ProfileStage>(stage))
+                    << ": mean " << juce::String(mean, 2) << " us"
+                    << ", max " << juce::String(s.maxMicros, 2) << " us" << juce::newLine;
+
+            for (int bucket = 0; bucket < numBuckets; bucket++) {
+                if (s.histogram[bucket] == 0) {
+                    continue;
+                }
+
+                summary << "    < " << (1 << bucket) << " us: " << s.histogram[bucket] << juce::newLine;
+            }
+        }
+
+        if (numBlocks > 0) {
+            const auto& p = worstBlock.parameters;
+            summary << "Worst block " << worstBlock.blockIndex
+                    << ": " << juce::String(juce::Time::highResolutionTicksToSeconds(worstBlock.getTotalTicks()) * 1.0e6, 2) << " us"
+                    << " of " << juce::String(worstBlock.getBudgetSeconds() * 1.0e6, 2) << " us budget"
+                    << " (pre gain " << p.saturatorPreGainDb << " dB"
+                    << ", type " << p.saturatorType
+                    << ", steam " << p.steamerGainDb << " dB"
+                    << ", room " << p.reverbRoomSize
+                    << ", lfo " << p.lfoRate << " Hz)" << juce::newLine;
+        }
+
+        return summary;
+    }
+
+private:
+    static constexpr int numBuckets = 16;
+
+    struct StageStatistics
+    {
+        double totalMicros { 0.0 };
+        double maxMicros { 0.0 };
+        juce::int64 histogram[numBuckets] {};
+    };
+
+    void run() override
+    {
+        while (! threadShouldExit()) {
+            drain();
+            wait(50);
+        }
+
+        drain();
+    }
+
+    void drain()
+    {
+        for (;;) {
+            const auto numRead = profiler.read(scratch.data(), static_cast<int>(scratch.size()));
+
+            if (numRead == 0) {
+                return;
+            }
+
+            for (int i = 0; i < numRead; i++) {
+                addToSummary(scratch[static_cast<size_t>(i)]);
+            }
+
+            const juce::ScopedLock sl(traceLock);
+
+            for (int i = 0; i < numRead && traceStream != nullptr; i++) {
+                const auto& block = scratch[static_cast<size_t>(i)];
+                writeTraceEvents(*traceStream, block);
+                traceSecondsLeft -= block.getBudgetSeconds();
+
+                if (traceSecondsLeft <= 0.0) {
+                    finishTrace();
+                }
+            }
+        }
+    }
+
+    // Closes the JSON array, call it with the trace lock held
+    void finishTrace()
+    {
+        if (traceStream == nullptr) {
+            return;
+        }
+
+        *traceStream << juce::newLine << "]}" << juce::newLine;
+        traceStream->flush();
+        traceStream.reset();
+    }
+
+    void addToSummary(const ProfileBlock& block)
+    {
+        const juce::ScopedLock sl(summaryLock);
+
+        for (int stage = 0; stage < numProfileStages; stage++) {
+            const auto micros = juce::Time::highResolutionTicksToSeconds(block.stageTicks[stage]) * 1.0e6;
+            auto& s = stages[stage];
+
+            s.totalMicros += micros;
+            s.maxMicros = std::max(s.maxMicros, micros);
+
+            auto bucket = 0;
+            while (bucket < numBuckets - 1 && micros >= static_cast<double>(1 << bucket)) {
+                bucket++;
+            }
+
+            s.histogram[bucket]++;
+        }
+
+        if (numBlocks == 0 || block.getTotalTicks() > worstBlock.getTotalTicks()) {
+            worstBlock = block;
+        }
+
+        if (juce::Time::highResolutionTicksToSeconds(block.getTotalTicks()) > block.getBudgetSeconds()) {
+            numOverruns++;
+        }
+
+        numBlocks++;
+    }
+
+    // Stages are written back to back from the start of the block in the
+    // order they ran, the time of the block is the sum of its stages
+    void writeTraceEvents(juce::OutputStream& stream, const ProfileBlock& block)
+    {
+        const auto toMicros = [] (juce::int64 ticks) {
+            return juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e6;
+        };
+
+        const auto& p = block.parameters;
+        juce::String args;
+        args << "\"block\":" << block.blockIndex
+             << ",\"numSamples\":" << block.numSamples
+             << ",\"budgetUs\":" << block.getBudgetSeconds() * 1.0e6
+             << ",\"preGainDb\":" << p.saturatorPreGainDb
+             << ",\"saturatorType\":" << p.saturatorType
+             << ",\"steamerGainDb\":" << p.steamerGainDb
+             << ",\"roomSize\":" << p.reverbRoomSize
+             << ",\"lfoRate\":" << p.lfoRate;
+
+        auto ts = toMicros(block.startTicks);
+
+        writeEvent(stream, "processBlock", ts, toMicros(block.getTotalTicks()), 0, args);
+
+        for (int position = 0; position < block.numStagesRun; position++) {
+            const auto stage = block.runOrder[position];
+            const auto dur = toMicros(block.stageTicks[static_cast<int>(stage)]);
+            writeEvent(stream, getProfileStageName(stage), ts, dur, 1, args);
+            ts += dur;
+        }
+    }
+
+    void writeEvent(juce::OutputStream& stream, const char* name, double ts, double dur, int tid, const juce::String& args)
+    {
+        if (! firstEvent) {
+            stream << "," << juce::newLine;
+        }
+
+        firstEvent = false;
+
+        stream << "{\"name\":\"" << name << "\",\"cat\":\"dsp\",\"ph\":\"X\""
+               << ",\"ts\":" << juce::String(ts, 3)
+               << ",\"dur\":" << juce::String(dur, 3)
+               << ",\"pid\":" << pid
+               << ",\"tid\":" << tid
+               << ",\"args\":{" << args << "}}";
+    }
+
+    StageProfiler& profiler;
+    const int pid;
+    std::vector<ProfileBlock> scratch;
+
+    // Trace requested from the message thread, written by the exporter
+    juce::CriticalSection traceLock;
+    std::unique_ptr<juce::FileOutputStream> traceStream;
+    juce::File traceFile;
+    double traceSecondsLeft { 0.0 };
+    bool firstEvent { true };
+
+    juce::CriticalSection summaryLock;
+    StageStatistics stages[numProfileStages];
+    ProfileBlock worstBlock;
+    juce::int64 numBlocks { 0 };
+    juce::int64 numOverruns { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE(StageProfileExporter)
+};
+
+} // end sauna namespace
+
+// Times the rest of the enclosing scope as one stage of the current block.
+// Compiles to nothing unless SAUNA_ENABLE_PROFILING is set.
+#if SAUNA_ENABLE_PROFILING
+ #define SAUNA_PROFILE_STAGE(profiler, stage) \
+    const sauna::ScopedStageTimer JUCE_JOIN_MACRO(saunaStageTimer_, __LINE__)(profiler, stage)
+#else
+ #define SAUNA_PROFILE_STAGE(profiler, stage)
+#endif
@@ -0,0 +1,471 @@
+#pragma once
+
+namespace sauna {
+
+// Number of points in a compiled curve table, spread evenly across
+// [-inputRange, inputRange]
+constexpr int numCurveTablePoints = 1025;
+
+// A user defined transfer curve, either a monotone cubic spline through
+// control points or an expression of x
+class TransferCurve {
+public:
+    struct ControlPoint
+    {
+        double x { 0.0 };
+        double y { 0.0 };
+    };
+
+    TransferCurve() : expression("x / (1 + abs(x))") {}
+
+    static TransferCurve fromControlPoints(std::vector<ControlPoint> points)
+    {
+        TransferCurve curve;
+        curve.spline = true;
+        curve.controlPoints = std::move(points);
+        curve.expression = juce::String();
+        return curve;
+    }
+
+    static TransferCurve fromExpression(const juce::String& text)
+    {
+        TransferCurve curve;
+        curve.expression = text;
+        return curve;
+    }
+
+    bool isSpline() const { return spline; }
+    const std::vector<ControlPoint>& getControlPoints() const { return controlPoints; }
+    const juce::String& getExpression() const { return expression; }
+
+    std::unique_ptr<juce::XmlElement> createXml() const
+    {
+        auto xml = std::make_unique<juce::XmlElement>("TRANSFER_CURVE");
+
+        if (spline) {
+            for (const auto& point : controlPoints) {
+                auto* child = xml->createNewChildElement("POINT");
+                child->setAttribute("x", point.x);
+                child->setAttribute("y", point.y);
+            }
+        } else {
+            xml->setAttribute("expression", expression);
+        }
+
+        return xml;
+    }
+
+    static TransferCurve fromXml(const juce::XmlElement& xml)
+    {
+        if (xml.hasAttribute("expression")) {
+            return fromExpression(xml.getStringAttribute("expression"));
+        }
+
+        std::vector<ControlPoint> points;
+
+        for (auto* child : xml.getChildWithTagNameIterator("POINT")) {
+            points.push_back({ child->getDoubleAttribute("x"), child->getDoubleAttribute("y") });
+        }
+
+        return fromControlPoints(std::move(points));
+    }
+
+private:
+    bool spline { false };
+    std::vector<ControlPoint> controlPoints;
+    juce::String expression;
+};
+
+
+// A curve sampled into numCurveTablePoints values, ready to be turned into a
+// CurveTable of any sample type
+struct CompiledCurve
+{
+    std::vector<double> values;
+    double inputRange { 4.0 };
+};
+
+
+// Linearly interpolated lookup table of a compiled curve. Inputs outside
+// [-inputRange, inputRange] hold the end values, NaN reads the value at 0.
+template <typename SampleType>
+class CurveTable {
+public:
+    explicit CurveTable(const CompiledCurve& curve)
+        : inputRange(static_cast<SampleType>(curve.inputRange)),
+          scale(static_cast<SampleType>((numCurveTablePoints - 1) / (2.0 * curve.inputRange)))
+    {
+        jassert(curve.values.size() == static_cast<size_t>(numCurveTablePoints));
+
+        // One guard point so inputs at +inputRange can read index + 1
+        values.malloc(numCurveTablePoints + 1);
+
+        for (int i = 0; i < numCurveTablePoints; i++) {
+            values[i] = static_cast<SampleType>(curve.values[static_cast<size_t>(i)]);
+        }
+
+        values[numCurveTablePoints] = values[numCurveTablePoints - 1];
+    }
+
+    // No copy semantics
+    CurveTable(const CurveTable&) = delete;
+    const CurveTable& operator=(const CurveTable&) = delete;
+
+    SampleType evaluate(SampleType x) const noexcept
+    {
+        // jlimit passes NaN through and casting it to int is undefined, so
+        // NaN is replaced before a clamp that cannot return it
+        const auto clamped = std::fmin(std::fmax(x == x ? x : static_cast<SampleType>(0), -inputRange), inputRange);
+        const auto position = (clamped + inputRange) * scale;
+        const auto index = static_cast<int>(position);
+        const auto fraction = position - static_cast<SampleType>(index);
+        const auto a = values[index];
+        return a + fraction * (values[index + 1] - a);
+    }
+
+    // evaluate() on SIMDRegisters: the clamp, the index and fraction math
+    // and the interpolation run on whole vectors, only the two table reads
+    // are made lane by lane since SSE2 has no gather. The samples before the
+    // first aligned one and the tail go through evaluate().
+    void process(SampleType* data, int numSamples) const noexcept
+    {
+        using Vector = juce::dsp::SIMDRegister<SampleType>;
+        constexpr auto lanes = static_cast<int>(Vector::SIMDNumElements);
+
+        const auto numUnaligned = std::min(numSamples, static_cast<int>(Vector::getNextSIMDAlignedPtr(data) - data));
+        int i = 0;
+
+        for (; i < numUnaligned; i++) {
+            data[i] = evaluate(data[i]);
+        }
+
+        const auto lowest = Vector::expand(-inputRange);
+        const auto highest = Vector::expand(inputRange);
+        alignas(Vector::SIMDRegisterSize) SampleType positions[lanes];
+        alignas(Vector::SIMDRegisterSize) SampleType indices[lanes];
+        alignas(Vector::SIMDRegisterSize) SampleType starts[lanes];
+        alignas(Vector::SIMDRegisterSize) SampleType slopes[lanes];
+
+        for (; i + lanes <= numSamples; i += lanes) {
+            // NaN fails the comparison with itself and is masked to 0
+            auto x = Vector::fromRawArray(data + i);
+            x = x & Vector::equal(x, x);
+
+            const auto position = (Vector::min(Vector::max(x, lowest), highest) + inputRange) * scale;
+            position.copyToRawArray(positions);
+
+            for (int lane = 0; lane < lanes; lane++) {
+                const auto index = static_cast<int>(positions[lane]);
+                indices[lane] = static_cast<SampleType>(index);
+                starts[lane] = values[index];
+                slopes[lane] = values[index + 1] - values[index];
+            }
+
+            const auto fraction = position - Vector::fromRawArray(indices);
+            (Vector::fromRawArray(starts) + fraction * Vector::fromRawArray(slopes)).copyToRawArray(data + i);
+        }
+
+        for (; i < numSamples; i++) {
+            data[i] = evaluate(data[i]);
+        }
+    }
+
+private:
+    const SampleType inputRange;
+    const SampleType scale;
+    juce::HeapBlock<SampleType> values;
+};
+
+
+// Background thread that compiles transfer curves into tables. Only the most
+// recent request is compiled, finished curves are passed to onCurveCompiled
+// on the compiler thread.
+class TransferCurveCompiler : private juce::Thread {
+public:
+    TransferCurveCompiler() : juce::Thread("Sauna curve compiler") {}
+
+    ~TransferCurveCompiler() override
+    {
+        stopThread(2000);
+    }
+
+    std::function<void(const CompiledCurve&)> onCurveCompiled;
+
+    // The thread is only started by the first request
+    void compile(const TransferCurve& curve)
+    {
+        {
+            const juce::ScopedLock sl(lock);
+            pendingCurve = curve;
+            hasPendingCurve = true;
+        }
+
+        if (! isThreadRunning()) {
+            startThread();
+        }
+
+        notify();
+    }
+
+    // Compiles on the calling thread and hands the table over from there.
+    // The compiler thread is stopped first and drops its request, so the
+    // tables are never handed over from two threads at once. The next
+    // compile() starts it again.
+    void compileNow(const TransferCurve& curve)
+    {
+        stopThread(-1);
+
+        {
+            const juce::ScopedLock sl(lock);
+            hasPendingCurve = false;
+        }
+
+        CompiledCurve compiled;
+        juce::String error;
+        const auto compiledOk = compileCurve(curve, compiled, error);
+
+        {
+            const juce::ScopedLock sl(lock);
+            lastError = error;
+        }
+
+        if (compiledOk && onCurveCompiled != nullptr) {
+            onCurveCompiled(compiled);
+        }
+    }
+
+    // Error of the last curve that failed to compile, empty if it compiled
+    juce::String getLastError() const
+    {
+        const juce::ScopedLock sl(lock);
+        return lastError;
+    }
+
+    // Samples the curve at four times the table resolution and smooths it
+    // with a Hann kernel before decimating. Corners in a transfer curve
+    // produce harmonics all the way up, rounding them off band limits what
+    // the table adds to the signal.
+    static bool compileCurve(const TransferCurve& curve, CompiledCurve& result, juce::String& error)
+    {
+        const int oversampling = 4;
+        const int kernelHalfWidth = 4 * oversampling;
+        const int numFinePoints = (numCurveTablePoints - 1) * oversampling + 1;
+        const auto range = result.inputRange;
+
+        std::vector<double> fine(static_cast<size_t>(numFinePoints));
+
+        if (! sampleCurve(curve, range, fine, error)) {
+            return false;
+        }
+
+        // The output is kept within the input range
+        for (auto& value : fine) {
+            value = std::isfinite(value) ? juce::jlimit(-range, range, value) : 0.0;
+        }
+
+        double kernel[2 * kernelHalfWidth + 1];
+        double kernelSum = 0.0;
+
+        for (int k = -kernelHalfWidth; k <= kernelHalfWidth; k++) {
+            const auto w = 0.5 + 0.5 * std::cos(juce::MathConstants<double>::pi * k / (kernelHalfWidth + 1));
+            kernel[k + kernelHalfWidth] = w;
+            kernelSum += w;
+        }
+
+        result.values.resize(static_cast<size_t>(numCurveTablePoints));
+
+        for (int i = 0; i < numCurveTablePoints; i++) {
+            const auto centre = i * oversampling;
+            double sum = 0.0;
+
+            for (int k = -kernelHalfWidth; k <= kernelHalfWidth; k++) {
+                const auto index = juce::jlimit(0, numFinePoints - 1, centre + k);
+                sum += kernel[k + kernelHalfWidth] * fine[static_cast<size_t>(index)];
+            }
+
+            result.values[static_cast<size_t>(i)] = sum / kernelSum;
+        }
+
+        error = juce::String();
+        return true;
+    }
+
+private:
+    void run() override
+    {
+        while (! threadShouldExit()) {
+            TransferCurve curve;
+            bool hasCurve = false;
+
+            {
+                const juce::ScopedLock sl(lock);
+                std::swap(hasCurve, hasPendingCurve);
+                curve = pendingCurve;
+            }
+
+            if (! hasCurve) {
+                wait(-1);
+                continue;
+            }
+
+            CompiledCurve compiled;
+            juce::String error;
+            const auto compiledOk = compileCurve(curve, compiled, error);
+
+            {
+                const juce::ScopedLock sl(lock);
+                lastError = error;
+            }
+
+            if (compiledOk && onCurveCompiled != nullptr) {
+                onCurveCompiled(compiled);
+            }
+        }
+    }
+
+    // Lets expressions use x and a few functions juce::Expression lacks
+    class CurveScope : public juce::Expression::Scope {
+    public:
+        double x { 0.0 };
+
+        juce::Expression getSymbolValue(const juce::String& symbol) const override
+        {
+            if (symbol == "x") {
+                return juce::Expression(x);
+            }
+
+            return juce::Expression::Scope::getSymbolValue(symbol);
+        }
+
+        double evaluateFunction(const juce::String& functionName, const double* parameters, int numParameters) const override
+        {
+            if (numParameters == 1) {
+                if (functionName == "tanh") return std::tanh(parameters[0]);
+                if (functionName == "atan") return std::atan(parameters[0]);
+                if (functionName == "exp")  return std::exp(parameters[0]);
+                if (functionName == "sqrt") return std::sqrt(parameters[0]);
+                if (functionName == "sign") return parameters[0] < 0.0 ? -1.0 : 1.0;
+            }
+
+            return juce::Expression::Scope::evaluateFunction(functionName, parameters, numParameters);
+        }
+    };
+
+    static bool sampleCurve(const TransferCurve& curve, double range, std::vector<double>& output, juce::String& error)
+    {
+        const auto numPoints = static_cast<int>(output.size());
+        const auto step = 2.0 * range / (numPoints - 1);
+
+        if (curve.isSpline()) {
+            return sampleSpline(curve.getControlPoints(), -range, step, output, error);
+        }
+
+        const juce::Expression expression(curve.getExpression(), error);
+
+        if (error.isNotEmpty()) {
+            return false;
+        }
+
+        CurveScope scope;
+
+        for (int i = 0; i < numPoints; i++) {
+            scope.x = -range + step * i;
+            output[static_cast<size_t>(i)] = expression.evaluate(scope, error);
+
+            if (error.isNotEmpty()) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Monotone cubic Hermite spline (Fritsch-Carlson), flat outside the
+    // first and last control points
+    static bool sampleSpline(std::vector<TransferCurve::ControlPoint> points, double start, double step,
+                             std::vector<double>& output, juce::String& error)
+    {
+        std::sort(points.begin(), points.end(), [] (const auto& a, const auto& b) { return a.x < b.x; });
+        points.erase(std::unique(points.begin(), points.end(), [] (const auto& a, const auto& b) { return a.x == b.x; }),
+                     points.end());
+
+        if (points.size() < 2) {
+            error = "A spline curve needs at least two control points";
+            return false;
+        }
+
+        const auto n = points.size();
+        std::vector<double> slopes(n - 1), tangents(n);
+
+        for (size_t k = 0; k < n - 1; k++) {
+            slopes[k] = (points[k + 1].y - points[k].y) / (points[k + 1].x - points[k].x);
+        }
+
+        tangents[0] = slopes[0];
+        tangents[n - 1] = slopes[n - 2];
+
+        for (size_t k = 1; k < n - 1; k++) {
+            tangents[k] = slopes[k - 1] * slopes[k] <= 0.0 ? 0.0 : 0.5 * (slopes[k - 1] + slopes[k]);
+        }
+
+        for (size_t k = 0; k < n - 1; k++) {
+            if (slopes[k] == 0.0) {
+                tangents[k] = tangents[k + 1] = 0.0;
+                continue;
+            }
+
+            const auto a = tangents[k] / slopes[k];
+            const auto b = tangents[k + 1] / slopes[k];
+            const auto s = a * a + b * b;
+
+            if (s > 9.0) {
+                const auto t = 3.0 / std::sqrt(s);
+                tangents[k] = t * a * slopes[k];
+                tangents[k + 1] = t * b * slopes[k];
+            }
+        }
+
+        size_t segment = 0;
+
+        for (size_t i = 0; i < output.size(); i++) {
+            const auto x = start + step * static_cast<double>(i);
+
+            if (x <= points.front().x) {
+                output[i] = points.front().y;
+                continue;
+            }
+
+            if (x >= points.back().x) {
+                output[i] = points.back().y;
+                continue;
+            }
+
+            while (x > points[segment + 1].x) {
+                segment++;
+            }
+
+            const auto& p0 = points[segment];
+            const auto& p1 = points[segment + 1];
+            const auto h = p1.x - p0.x;
+            const auto t = (x - p0.x) / h;
+            const auto t2 = t * t;
+            const auto t3 = t2 * t;
+
+            output[i] = (2.0 * t3 - 3.0 * t2 + 1.0) * p0.y
+                      + (t3 - 2.0 * t2 + t) * h * tangents[segment]
+                      + (-2.0 * t3 + 3.0 * t2) * p1.y
+                      + (t3 - t2) * h * tangents[segment + 1];
+        }
+
+        return true;
+    }
+
+    juce::CriticalSection lock;
+    TransferCurve pendingCurve;
+    bool hasPendingCurve { false };
+    juce::String lastError;
+
+    JUCE_DECLARE_NON_COPYABLE(TransferCurveCompiler)
+};
+
+} // end sauna namespace
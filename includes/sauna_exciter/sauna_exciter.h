@@ -15,27 +15,77 @@
 
 #pragma once
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <vector>
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_dsp/juce_dsp.h>
 
+//==============================================================================
+/** Config: SAUNA_ENABLE_PROFILING
+    Times every stage of the exciter chain and exports the timings from a
+    background thread. Leave disabled for release builds.
+*/
+#ifndef SAUNA_ENABLE_PROFILING
+ #define SAUNA_ENABLE_PROFILING 0
+#endif
+
+#include "sauna_ReverbCore.h"
+#include "sauna_TransferCurve.h"
+#include "sauna_LinkwitzRileyBank.h"
+#include "sauna_SizzleGenerator.h"
+
 namespace sauna {
 
+// This enum is the only thing that is necessary to hook up to the front end
+enum SaturationType
+{
+    Tanh,
+    ASinh,
+    HardClipping,
+    SoftClipping,
+    Tube,
+    Custom      // User defined curve, see TransferCurve
+};
+
+// Accuracy of the transcendental curves, Fast swaps the std:: functions
+// for approximations
+enum class SaturatorPrecision
+{
+    Accurate,
+    Fast
+};
+
+// Spectral shaping of the steam noise towards pink, using Paul Kellet's
+// economy (3 pole) and refined (7 pole) filters
+enum class NoiseShaping
+{
+    None,
+    Economy,
+    Refined
+};
+
+
+template <typename SampleType>
 class Saturator {
 public:
-    Saturator(): preGain {juce::Decibels::decibelsToGain(6.0f)}, tubeQ {-0.2f}, tubeDist {8.0f} {
+    using SaturationType = sauna::SaturationType;
+    using Precision = SaturatorPrecision;
+    using Table = CurveTable<SampleType>;
+    
+    Saturator(): preGain {juce::Decibels::decibelsToGain(static_cast<SampleType>(6))}, tubeQ {static_cast<SampleType>(-0.2)}, tubeDist {8} {
+        tubeOffset = tubeQ / (1 - std::exp(tubeDist * tubeQ));
         setSaturation(SaturationType::Tube);
+        reset();
     };
     
-    ~Saturator() {};
-    
-    // This enum is the only thing that is necessary to hook up to the front end
-    enum SaturationType
+    ~Saturator()
     {
-        Tanh,
-        ASinh,
-        HardClipping,
-        SoftClipping,
-        Tube
+        releaseRetiredCurves();
+        delete incomingTable.exchange(nullptr);
+        delete customTable;
+        delete previousTable;
     };
     
     // No copy semantics
@@ -46,168 +96,1047 @@ public:
     Saturator(Saturator&&) = delete;
     const Saturator& operator=(Saturator&&) = delete;
     
+    // Safe to call from any thread. The audio thread picks the new type up at
+    // the start of its next block and crossfades to it.
     void setSaturation(SaturationType type) {
-        if (type == SaturationType::Tanh) {
-            saturation = [this] (float x) {return applyTanh(x);};
+        if (type < SaturationType::Tanh || type > SaturationType::Custom) {
+            // If you hit this assertion is because you selected an invalid saturation type
+            jassert(false);
+            return;
         }
         
-        else if (type == SaturationType::ASinh) {
-            saturation = [this] (float x) {return applyASinh(x);};
+        requestedType.store(static_cast<int>(type), std::memory_order_relaxed);
+    }
+    
+    // The type currently being rendered, or being faded to
+    SaturationType getSaturation() const { return saturationType; }
+    
+    // Length of the crossfade between two types, in samples at the rate the
+    // saturator runs at
+    void setCrossfadeLength(int numSamples)
+    {
+        jassert(numSamples > 0);
+        crossfadeStep = static_cast<SampleType>(1) / static_cast<SampleType>(std::max(numSamples, 1));
+    }
+    
+    // Hands a new custom curve to the audio thread, which swaps it in at the
+    // start of a block and crossfades to it if the custom curve is playing.
+    // Call it from one background thread only, it also frees the tables the
+    // audio thread has finished with.
+    void setCustomCurve(std::unique_ptr<Table> table)
+    {
+        releaseRetiredCurves();
+        
+        // A table the audio thread never picked up can go straight away
+        delete incomingTable.exchange(table.release());
+    }
+    
+    // Jumps straight to the requested type
+    void reset()
+    {
+        saturationType = previousType = static_cast<SaturationType>(requestedType.load(std::memory_order_relaxed));
+        crossfadeProgress = 1;
+        retire(previousTable);
+        previousTable = nullptr;
+    }
+    
+    bool isCrossfading() const { return crossfadeProgress < 1; }
+    
+    void setPreGain(float db)
+    {
+        preGain = juce::Decibels::decibelsToGain(static_cast<SampleType>(db));
+    }
+    
+    void setPrecision(Precision newPrecision) { precision = newPrecision; }
+    Precision getPrecision() const { return precision; }
+    
+    // Scalar versions of the curves, the block kernels below must match them
+    SampleType applyTanh(SampleType x)
+    {
+        if (precision == Precision::Fast) {
+            return fastTanh(x);
         }
         
-        else if (type == SaturationType::HardClipping) {
-            saturation = [this] (float x) {return applyHardClipping(x);};
+        return std::tanh(x);
+    }
+    
+    SampleType applyASinh(SampleType x)
+    {
+        if (precision == Precision::Fast) {
+            return fastASinh(x);
         }
         
-        else if (type == SaturationType::SoftClipping) {
-            saturation = [this] (float x) {return applySoftClipping(x);};
+        return std::asinh(x);
+    }
+    
+    SampleType applySoftClipping(SampleType x)
+    {
+        if (x > 1) {
+            return static_cast<SampleType>(2.0 / 3.0);
         }
         
-        else if (type == SaturationType::Tube) {
-            saturation = [this] (float x) {return applyTubeSaturator(x);};
+        if (x < -1) {
+            return static_cast<SampleType>(-2.0 / 3.0);
         }
         
-        else {
-            // If you hit this assertion is because you selected an invalid saturation type
-            jassert(false);
+        return x - (x * x * x) / 3;
+    }
+    
+    SampleType applyHardClipping(SampleType x)
+    {
+        if (x > 1) {
+            return 1;
         }
+        
+        if (x < -1) {
+            return -1;
+        }
+        
+        return x;
     }
     
-    void setPreGain(float db)
+    SampleType applyTubeSaturator(SampleType x)
     {
-        preGain = juce::Decibels::decibelsToGain(db);
+        const auto exponent = -1 * tubeDist * (x - tubeQ);
+        
+        // (x - q) / (1 - e^u) is u / (e^u - 1) / dist, which has no pole at x == q
+        if (precision == Precision::Fast) {
+            return fastExponentialRatio(exponent) / tubeDist + tubeOffset;
+        }
+        
+        if (x == tubeQ) {
+            return (1 / tubeDist) + tubeOffset;
+        }
+        
+        return ((x - tubeQ) / (1 - std::exp(exponent))) + tubeOffset;
     }
     
-    float applyTanh(float x)
+    SampleType saturate(SampleType x)
+    {
+        switch (saturationType) {
+            case SaturationType::Tanh:         return applyTanh(x);
+            case SaturationType::ASinh:        return applyASinh(x);
+            case SaturationType::HardClipping: return applyHardClipping(x);
+            case SaturationType::SoftClipping: return applySoftClipping(x);
+            case SaturationType::Tube:         return applyTubeSaturator(x);
+            case SaturationType::Custom:       return customTable != nullptr ? customTable->evaluate(x) : x;
+        }
+        
+        return x;
+    }
+
+    void process(SampleType* const* output, const SampleType* const* input, unsigned int numChannels, unsigned int numSamples)
     {
-        return std::tanhf(x);
+        startBlock();
+        render(output, input, numChannels, numSamples);
+        finishBlock(numSamples);
     }
     
-    float applyASinh(float x)
+    // process() in three steps, for rendering one block more than once at
+    // different rates. startBlock() takes the pending type and curve,
+    // render() can then run any number of times from the same crossfade
+    // position, and finishBlock() moves the crossfade on by numSamples at
+    // the rate of the last setCrossfadeLength().
+    void startBlock()
     {
-        return std::asinhf(x);
+        updateSaturation();
     }
     
-    float applySoftClipping(float x)
+    void render(SampleType* const* output, const SampleType* const* input, unsigned int numChannels, unsigned int numSamples)
     {
-        if (x > 1.0f) {
-            return 2.0f / 3.0f;
+        // To avoid using it in more than 2 channels
+        numChannels = std::min(numChannels, 2u);
+        
+        for (unsigned int channel = 0; channel < numChannels; channel++)
+        {
+            processChannel(output[channel], input[channel], numSamples);
         }
+    }
+    
+    void finishBlock(unsigned int numSamples)
+    {
+        advanceCrossfade(numSamples);
+    }
+    
+    void process(SampleType*  left,
+                 SampleType*  right,
+                 const float*  modInput,
+                 unsigned int numChannels,
+                 unsigned int numSamples)
+    {
+        updateSaturation();
+        processChannel(left, left, numSamples);
         
-        if (x < -1.0f) {
-            return -2.0f / 3.0f;
+        if (left != right) {
+            processChannel(right, right, numSamples);
         }
         
-        return x - (x * x * x) / 3.0f;
+        advanceCrossfade(numSamples);
     }
     
-    float applyHardClipping(float x)
+private:
+    // A new request is only taken once the running crossfade has finished,
+    // restarting it halfway would jump
+    void updateSaturation()
     {
-        if (x > 1.0f) {
-            return 1.0f;
+        if (isCrossfading()) {
+            return;
         }
         
-        if (x < -1.0f) {
-            return -1.0f;
+        updateCustomCurve();
+        
+        const auto requested = static_cast<SaturationType>(requestedType.load(std::memory_order_relaxed));
+        
+        if (requested == saturationType || isCrossfading()) {
+            return;
         }
         
-        return x;
+        previousType = saturationType;
+        saturationType = requested;
+        crossfadeProgress = 0;
     }
     
-    float applyTubeSaturator(float x)
+    // Takes a new table if there is one and there is room to retire the old
+    void updateCustomCurve()
     {
-        if (x == tubeQ) {
-            return (1.0f / tubeDist) + (tubeQ / (1.0f - expf(tubeDist * tubeQ)));
+        if (incomingTable.load(std::memory_order_acquire) == nullptr || retiredFifo.getFreeSpace() < 1) {
+            return;
+        }
+        
+        auto* table = incomingTable.exchange(nullptr, std::memory_order_acq_rel);
+        
+        if (table == nullptr) {
+            return;
+        }
+        
+        if (saturationType == SaturationType::Custom && customTable != nullptr) {
+            // Fade from the old table, it is retired once the fade is over
+            previousTable = customTable;
+            previousType = SaturationType::Custom;
+            crossfadeProgress = 0;
         } else {
-            return ((x - tubeQ) / (1.0f - (expf(-1.0f * tubeDist * (x - tubeQ))))) + (tubeQ / (1.0f - expf(tubeDist * tubeQ)));
+            retire(customTable);
         }
+        
+        customTable = table;
     }
+    
+    void advanceCrossfade(unsigned int numSamples)
+    {
+        if (isCrossfading()) {
+            crossfadeProgress = std::min(static_cast<SampleType>(1), crossfadeProgress + crossfadeStep * static_cast<SampleType>(numSamples));
+            
+            if (! isCrossfading()) {
+                retire(previousTable);
+                previousTable = nullptr;
+            }
+        }
+    }
+    
+    // Audio thread, the table is freed by the next setCustomCurve() call
+    void retire(const Table* table)
+    {
+        if (table == nullptr) {
+            return;
+        }
+        
+        const auto scope = retiredFifo.write(1);
+        
+        // There is always room, a table is only swapped in while there is
+        jassert(scope.blockSize1 > 0);
+        
+        if (scope.blockSize1 > 0) {
+            retiredTables[scope.startIndex1] = table;
+        }
+    }
+    
+    void releaseRetiredCurves()
+    {
+        const auto scope = retiredFifo.read(retiredFifo.getNumReady());
+        
+        for (int i = 0; i < scope.blockSize1; i++) {
+            delete retiredTables[scope.startIndex1 + i];
+        }
+        
+        for (int i = 0; i < scope.blockSize2; i++) {
+            delete retiredTables[scope.startIndex2 + i];
+        }
+    }
+    
 
-    void process(float* const* output, const float* const* input, unsigned int numChannels, unsigned int numSamples)
+    // Block kernels. The pre gain goes through FloatVectorOperations, the
+    // curves are branch free loops so they vectorise for float and double.
+    void processChannel(SampleType* output, const SampleType* input, unsigned int numSamples)
     {
+        const auto n = static_cast<int>(numSamples);
+        juce::FloatVectorOperations::multiply(output, input, preGain, n);
         
-        // To avoid using it in more than 2 channels
-        numChannels = std::min(numChannels, 2u);
+        if (isCrossfading()) {
+            processCrossfade(output, n);
+            return;
+        }
         
-        for (unsigned int channel = 0; channel < numChannels; channel++)
-        {
-            for (unsigned int sample = 0; sample < numSamples; sample++)
-            {
-                // Unity gain for testing
-                output[channel][sample] = saturation(preGain * input[channel][sample]);
+        switch (saturationType) {
+            case SaturationType::HardClipping:
+                juce::FloatVectorOperations::clip(output, output, static_cast<SampleType>(-1), static_cast<SampleType>(1), n);
+                break;
+                
+            case SaturationType::SoftClipping:
+                // x - x^3 / 3 reaches +-2/3 at +-1, so clipping first gives the flat tails
+                juce::FloatVectorOperations::clip(output, output, static_cast<SampleType>(-1), static_cast<SampleType>(1), n);
+                
+                for (int i = 0; i < n; i++) {
+                    const auto x = output[i];
+                    output[i] = x - (x * x * x) * static_cast<SampleType>(1.0 / 3.0);
+                }
+                break;
+                
+            case SaturationType::Tanh:
+                if (precision == Precision::Fast) {
+                    for (int i = 0; i < n; i++) {
+                        output[i] = fastTanh(output[i]);
+                    }
+                } else {
+                    for (int i = 0; i < n; i++) {
+                        output[i] = std::tanh(output[i]);
+                    }
+                }
+                break;
+                
+            case SaturationType::ASinh:
+                if (precision == Precision::Fast) {
+                    for (int i = 0; i < n; i++) {
+                        output[i] = fastASinh(output[i]);
+                    }
+                } else {
+                    for (int i = 0; i < n; i++) {
+                        output[i] = std::asinh(output[i]);
+                    }
+                }
+                break;
+                
+            case SaturationType::Tube:
+                for (int i = 0; i < n; i++) {
+                    output[i] = applyTubeSaturator(output[i]);
+                }
+                break;
+                
+            case SaturationType::Custom:
+                if (customTable != nullptr) {
+                    customTable->process(output, n);
+                }
+                break;
+        }
+    }
+    
+    // Both curves run in the same loop and are mixed with a linear ramp that
+    // carries on from where the previous block stopped
+    void processCrossfade(SampleType* output, int numSamples)
+    {
+        const auto start = crossfadeProgress;
+        const auto step = crossfadeStep;
+        const auto* oldTable = previousTable != nullptr ? previousTable : customTable;
+        
+        withCurve(previousType, oldTable, [&] (auto oldCurve) {
+            withCurve(saturationType, customTable, [&] (auto newCurve) {
+                for (int i = 0; i < numSamples; i++) {
+                    const auto x = output[i];
+                    const auto gain = std::min(static_cast<SampleType>(1), start + step * static_cast<SampleType>(i + 1));
+                    const auto from = oldCurve(x);
+                    output[i] = from + gain * (newCurve(x) - from);
+                }
+            });
+        });
+    }
+    
+    // Calls function with the branch free scalar kernel of a curve, so the
+    // loop it is used in gets compiled once per curve
+    template <typename Function>
+    void withCurve(SaturationType type, const Table* table, Function&& function)
+    {
+        const auto fast = precision == Precision::Fast;
+        
+        switch (type) {
+            case SaturationType::HardClipping:
+                function([] (SampleType x) {
+                    return juce::jlimit(static_cast<SampleType>(-1), static_cast<SampleType>(1), x);
+                });
+                break;
+                
+            case SaturationType::SoftClipping:
+                function([] (SampleType x) {
+                    const auto c = juce::jlimit(static_cast<SampleType>(-1), static_cast<SampleType>(1), x);
+                    return c - (c * c * c) * static_cast<SampleType>(1.0 / 3.0);
+                });
+                break;
+                
+            case SaturationType::Tanh:
+                if (fast) {
+                    function([] (SampleType x) { return fastTanh(x); });
+                } else {
+                    function([] (SampleType x) { return std::tanh(x); });
+                }
+                break;
+                
+            case SaturationType::ASinh:
+                if (fast) {
+                    function([] (SampleType x) { return fastASinh(x); });
+                } else {
+                    function([] (SampleType x) { return std::asinh(x); });
+                }
+                break;
+                
+            case SaturationType::Tube:
+                function([this] (SampleType x) { return applyTubeSaturator(x); });
+                break;
+                
+            case SaturationType::Custom:
+                if (table != nullptr) {
+                    function([table] (SampleType x) { return table->evaluate(x); });
+                } else {
+                    function([] (SampleType x) { return x; });
+                }
+                break;
+        }
+    }
+    
+    // The Pade approximant is only valid in [-5, 5], tanh is flat outside anyway
+    static SampleType fastTanh(SampleType x)
+    {
+        return juce::dsp::FastMathApproximations::tanh(juce::jlimit(static_cast<SampleType>(-5), static_cast<SampleType>(5), x));
+    }
+    
+    static SampleType fastASinh(SampleType x)
+    {
+        const auto magnitude = std::abs(x);
+        return std::copysign(std::log(magnitude + std::sqrt(magnitude * magnitude + 1)), x);
+    }
+    
+    // exp(x) as 2^(x * log2(e)), the integer part goes into the exponent and
+    // the fraction through a 5th order minimax polynomial (~1.5e-7 relative error)
+    static SampleType fastExp(SampleType x)
+    {
+        const auto t = juce::jlimit(static_cast<SampleType>(-126), static_cast<SampleType>(126), x * static_cast<SampleType>(1.4426950408889634));
+        const auto whole = std::floor(t);
+        const auto f = t - whole;
+        const auto p = 1 + f * (static_cast<SampleType>(6.9315308e-1)
+                     + f * (static_cast<SampleType>(2.4015361e-1)
+                     + f * (static_cast<SampleType>(5.5826318e-2)
+                     + f * (static_cast<SampleType>(8.9893397e-3)
+                     + f * static_cast<SampleType>(1.8775767e-3)))));
+        return std::ldexp(p, static_cast<int>(whole));
+    }
+    
+    // u / (e^u - 1). The division cancels badly near 0, so small inputs use
+    // its series instead, both sides are computed to keep the loop branch free.
+    static SampleType fastExponentialRatio(SampleType u)
+    {
+        const auto u2 = u * u;
+        const auto series = 1 - u * static_cast<SampleType>(0.5)
+                          + u2 * (static_cast<SampleType>(1.0 / 12.0)
+                          - u2 * (static_cast<SampleType>(1.0 / 720.0)
+                          - u2 * static_cast<SampleType>(1.0 / 30240.0)));
+        const auto denominator = fastExp(u) - 1;
+        const auto direct = u / (denominator != 0 ? denominator : static_cast<SampleType>(1));
+        return std::abs(u) < static_cast<SampleType>(0.5) ? series : direct;
+    }
+    
+    SampleType preGain;
+    SampleType tubeQ;
+    SampleType tubeDist;
+    SampleType tubeOffset;
+    Precision precision { Precision::Accurate };
+    
+    // Type switching, requestedType is the only member written from other threads
+    std::atomic<int> requestedType { static_cast<int>(SaturationType::Tube) };
+    SaturationType saturationType { SaturationType::Tube };
+    SaturationType previousType { SaturationType::Tube };
+    SampleType crossfadeProgress { 1 };
+    SampleType crossfadeStep { static_cast<SampleType>(1.0 / 480.0) };
+    
+    // Custom curve handoff. Tables arrive through incomingTable and go back
+    // through retiredTables, the audio thread never allocates or frees one.
+    static constexpr int maxRetiredTables = 8;
+    std::atomic<Table*> incomingTable { nullptr };
+    const Table* customTable { nullptr };
+    const Table* previousTable { nullptr };
+    juce::AbstractFifo retiredFifo { maxRetiredTables };
+    const Table* retiredTables[maxRetiredTables] {};
+};
+
+
+// Splits the signal with a LinkwitzRileyBank and saturates every band with
+// its own Saturator, so each band has its own drive and saturation type and
+// the low end can stay clean at high pre gain. With one band it runs the
+// full band saturator it was given instead. The band saturators run the
+// same block kernels as the full band one. There is one crossover bank per
+// oversampling factor, each at its own rate, so the SaturatorProcessor can
+// crossfade between factors the same way it does for the full band.
+//
+// A change of the number of bands is crossfaded like a change of type:
+// every factor has a second bank, the new band count starts in it from
+// silence, runs unheard for bandSettleTime while the crossovers ring in and
+// then fades in over bandCrossfadeTime. Both band counts run through the
+// same band saturators.
+template <typename SampleType>
+class MultibandSaturator {
+public:
+    explicit MultibandSaturator(Saturator<SampleType>& fullBandSaturator) : fullBand(fullBandSaturator) {}
+    ~MultibandSaturator() {}
+    
+    // No copy semantics
+    MultibandSaturator(const MultibandSaturator&) = delete;
+    const MultibandSaturator& operator=(const MultibandSaturator&) = delete;
+    
+    // No move semantics
+    MultibandSaturator(MultibandSaturator&&) = delete;
+    const MultibandSaturator& operator=(MultibandSaturator&&) = delete;
+    
+    static constexpr double bandCrossfadeTime = 0.01;
+    static constexpr double bandSettleTime = 0.02;
+    
+    // Allocates two crossover banks for every factor up to 2^maxOrder and
+    // the band buffers for the largest oversampled block
+    void prepare(const juce::dsp::ProcessSpec& spec, size_t maxOrder)
+    {
+        banks.clear();
+        
+        for (size_t order = 0; order <= maxOrder; order++) {
+            for (int slot = 0; slot < 2; slot++) {
+                auto bank = std::make_unique<LinkwitzRileyBank<SampleType>>();
+                
+                for (int i = 0; i < numCrossovers; i++) {
+                    bank->setCrossoverFrequency(i, frequencies[i]);
+                }
+                
+                bank->setNumBands(std::max(numBands, 2));
+                bank->prepare(spec.sampleRate * static_cast<double>(1 << order));
+                banks.push_back(std::move(bank));
             }
         }
+        
+        const auto maxOversampledSamples = static_cast<int>(spec.maximumBlockSize << maxOrder);
+        bandBuffer.setSize(maxMultibandBands * maxChannels, maxOversampledSamples);
+        fadeBuffer.setSize(maxChannels, maxOversampledSamples);
+        fadeLength = std::max(1, juce::roundToInt(bandCrossfadeTime * spec.sampleRate));
+        settleLength = juce::roundToInt(bandSettleTime * spec.sampleRate);
+        reset();
     }
     
-    void process(float*  left,
-                 float*  right,
-                 const float*  modInput,
-                 unsigned int numChannels,
-                 unsigned int numSamples)
+    // Jumps straight to the requested number of bands
+    void reset()
+    {
+        activeBands = numBands;
+        fadePosition = settleLength + fadeLength;
+        
+        for (auto& bank : banks) {
+            bank->setNumBands(std::max(numBands, 2));
+            bank->reset();
+        }
+        
+        for (auto& saturator : saturators) {
+            saturator.reset();
+        }
+    }
+    
+    // 1 turns the multiband mode off, the change is crossfaded
+    void setNumBands(int newNumBands)
+    {
+        jassert(newNumBands >= 1 && newNumBands <= maxMultibandBands);
+        numBands = juce::jlimit(1, maxMultibandBands, newNumBands);
+    }
+    
+    int getNumBands() const { return numBands; }
+    bool isEnabled() const { return numBands > 1; }
+    
+    // Every bank glides to the new frequency
+    void setCrossoverFrequency(int index, float hz)
+    {
+        jassert(index >= 0 && index < numCrossovers);
+        frequencies[index] = hz;
+        
+        for (auto& bank : banks) {
+            bank->setCrossoverFrequency(index, hz);
+        }
+    }
+    
+    // The pre gain of the whole saturator, each band adds its drive on top
+    void setPreGain(float db)
+    {
+        preGain = db;
+        updateGains();
+    }
+    
+    void setBandDrive(int band, float db)
+    {
+        jassert(band >= 0 && band < maxMultibandBands);
+        drives[band] = db;
+        updateGains();
+    }
+    
+    // Crossfaded like the full band saturator
+    void setBandSaturation(int band, SaturationType type)
+    {
+        jassert(band >= 0 && band < maxMultibandBands);
+        saturators[band].setSaturation(type);
+    }
+    
+    void setPrecision(SaturatorPrecision precision)
+    {
+        for (auto& saturator : saturators) {
+            saturator.setPrecision(precision);
+        }
+    }
+    
+    void setCrossfadeLength(int numSamples)
+    {
+        for (auto& saturator : saturators) {
+            saturator.setCrossfadeLength(numSamples);
+        }
+    }
+    
+    // Every band saturator owns its table, call it from the same background
+    // thread as Saturator::setCustomCurve()
+    void setCustomCurve(const CompiledCurve& curve)
+    {
+        for (auto& saturator : saturators) {
+            saturator.setCustomCurve(std::make_unique<CurveTable<SampleType>>(curve));
+        }
+    }
+    
+    // Runs at the rate of the oversampling order, with its crossover bank
+    void process(SampleType* const* channels, unsigned int numChannels, unsigned int numSamples, size_t order)
+    {
+        startBlock();
+        render(channels, numChannels, numSamples, order);
+        finishBlock(numSamples >> order, order);
+    }
+    
+    // The steps of process(), same as the ones of Saturator. Each order has
+    // its own crossover banks, so rendering a block at two orders moves each
+    // bank on once. Every saturator is stepped, whether it is heard or not.
+    void startBlock()
+    {
+        fullBand.startBlock();
+        
+        for (auto& saturator : saturators) {
+            saturator.startBlock();
+        }
+        
+        // A new band count is only taken once the running fade has finished
+        if (! isFading() && numBands != activeBands) {
+            fadingOutBands = activeBands;
+            activeBands = numBands;
+            activeSlot = 1 - activeSlot;
+            
+            for (size_t order = 0; order < banks.size() / 2; order++) {
+                auto& bank = getBank(order, activeSlot);
+                bank.setNumBands(std::max(activeBands, 2));
+                bank.reset();
+            }
+            
+            fadePosition = 0;
+        }
+    }
+    
+    // Takes the number of samples at the base rate and the order the block
+    // was last rendered at
+    void finishBlock(unsigned int numSamples, size_t order)
+    {
+        const auto numOversampledSamples = numSamples << order;
+        fullBand.finishBlock(numOversampledSamples);
+        
+        for (auto& saturator : saturators) {
+            saturator.finishBlock(numOversampledSamples);
+        }
+        
+        fadePosition = std::min(fadePosition + static_cast<int>(numSamples), settleLength + fadeLength);
+    }
+    
+    // Clears the crossovers of one order, before it starts running again
+    void resetBank(size_t order)
+    {
+        jassert(order < banks.size() / 2);
+        
+        if (order < banks.size() / 2) {
+            getBank(order, 0).reset();
+            getBank(order, 1).reset();
+        }
+    }
+    
+    void render(SampleType* const* channels, unsigned int numChannels, unsigned int numSamples, size_t order)
     {
-        auto leftVal = *left;
-        auto rightVal = *right;
-        *left = saturation(preGain * leftVal);
-        *right = saturation(preGain * rightVal);
+        // If you hit this assertion prepare() has not been called with this order
+        jassert(order < banks.size() / 2);
+        
+        numChannels = std::min(numChannels, static_cast<unsigned int>(maxChannels));
+        
+        if (! isFading()) {
+            renderBands(activeBands, activeSlot, channels, numChannels, numSamples, order);
+            return;
+        }
+        
+        // If you hit this assertion the block is longer than the one prepare() was called with
+        jassert(static_cast<int>(numSamples) <= fadeBuffer.getNumSamples());
+        
+        SampleType* fadeChannels[maxChannels] { fadeBuffer.getWritePointer(0), fadeBuffer.getWritePointer(1) };
+        const auto n = static_cast<int>(numSamples);
+        
+        for (unsigned int channel = 0; channel < numChannels; channel++) {
+            juce::FloatVectorOperations::copy(fadeChannels[channel], channels[channel], n);
+        }
+        
+        renderBands(fadingOutBands, 1 - activeSlot, fadeChannels, numChannels, numSamples, order);
+        renderBands(activeBands, activeSlot, channels, numChannels, numSamples, order);
+        
+        // The fade is counted at the base rate, so every order fades alike
+        const auto factor = 1 << order;
+        const auto start = (fadePosition - settleLength) * factor;
+        const auto length = static_cast<SampleType>(fadeLength * factor);
+        
+        for (unsigned int channel = 0; channel < numChannels; channel++) {
+            auto* output = channels[channel];
+            const auto* faded = fadeChannels[channel];
+            
+            for (int i = 0; i < n; i++) {
+                const auto gain = static_cast<SampleType>(juce::jlimit(0, fadeLength * factor, start + i + 1)) / length;
+                output[i] = faded[i] + gain * (output[i] - faded[i]);
+            }
+        }
     }
     
+    Saturator<SampleType>& getBandSaturator(int band) { return saturators[band]; }
+    
 private:
-    float preGain;
-    float tubeQ;
-    float tubeDist;
-    std::function<float(float)> saturation;
+    static constexpr int maxChannels = 2;
+    
+    bool isFading() const { return fadePosition < settleLength + fadeLength; }
+    
+    LinkwitzRileyBank<SampleType>& getBank(size_t order, int slot) { return *banks[order * 2 + static_cast<size_t>(slot)]; }
+    
+    // Saturates in place with the given number of bands, one band is the
+    // full band saturator
+    void renderBands(int bandsToUse, int slot, SampleType* const* channels, unsigned int numChannels, unsigned int numSamples, size_t order)
+    {
+        if (bandsToUse < 2) {
+            fullBand.render(channels, channels, numChannels, numSamples);
+            return;
+        }
+        
+        const auto n = static_cast<int>(numSamples);
+        SampleType* bands[maxChannels][maxMultibandBands];
+        
+        for (int channel = 0; channel < maxChannels; channel++) {
+            for (int band = 0; band < maxMultibandBands; band++) {
+                bands[channel][band] = bandBuffer.getWritePointer(band * maxChannels + channel);
+            }
+        }
+        
+        SampleType* const* channelBands[maxChannels] { bands[0], bands[1] };
+        getBank(order, slot).process(channels, channelBands, static_cast<int>(numChannels), n);
+        
+        for (int band = 0; band < bandsToUse; band++) {
+            SampleType* bandChannels[maxChannels] { bands[0][band], bands[1][band] };
+            saturators[band].render(bandChannels, bandChannels, numChannels, numSamples);
+        }
+        
+        for (unsigned int channel = 0; channel < numChannels; channel++) {
+            auto* output = channels[channel];
+            juce::FloatVectorOperations::copy(output, bands[channel][0], n);
+            
+            for (int band = 1; band < bandsToUse; band++) {
+                juce::FloatVectorOperations::add(output, bands[channel][band], n);
+            }
+        }
+    }
+    
+    void updateGains()
+    {
+        for (int band = 0; band < maxMultibandBands; band++) {
+            saturators[band].setPreGain(preGain + drives[band]);
+        }
+    }
+    
+    Saturator<SampleType>& fullBand;
+    int numBands { 1 };
+    float frequencies[numCrossovers] { 150.0f, 1500.0f, 6000.0f };
+    float preGain { 6.0f };
+    float drives[maxMultibandBands] {};
+    
+    // Indexed by order * 2 + slot, the active band count runs in activeSlot
+    std::vector<std::unique_ptr<LinkwitzRileyBank<SampleType>>> banks;
+    juce::AudioBuffer<SampleType> bandBuffer;
+    Saturator<SampleType> saturators[maxMultibandBands];
+    
+    // Band count fade in samples at the base rate, fadingOutBands runs in
+    // the other slot while it lasts
+    juce::AudioBuffer<SampleType> fadeBuffer;
+    int activeBands { 1 };
+    int fadingOutBands { 1 };
+    int activeSlot { 0 };
+    int settleLength { 0 };
+    int fadeLength { 1 };
+    int fadePosition { 1 };
 };
 
 
-class SaturatorProcessor: public juce::dsp::ProcessorBase
+// Follows the juce::dsp processor convention (prepare, reset and a templated
+// process) so it works for both float and double, juce::dsp::ProcessorBase
+// is float only
+template <typename SampleType>
+class SaturatorProcessor
 {
 public:
-    SaturatorProcessor(): saturator() {};
+    SaturatorProcessor(): saturator(), multiband(saturator) {};
     ~SaturatorProcessor() {};
     
-    void prepare(const juce::dsp::ProcessSpec& spec) override {
+    // Oversampling factors that can be switched between, as powers of two
+    static constexpr size_t maxOversamplingOrder = 2;
+    
+    // Length of the fade between two oversampling factors. The new factor
+    // starts from silence and runs unheard for the settle time first, long
+    // enough for its oversampling filters and crossovers to ring out.
+    static constexpr double oversamplingCrossfadeTime = 0.01;
+    static constexpr double oversamplingSettleTime = 0.02;
+    
+    // Every oversampling factor is allocated here so that switching between
+    // them later never allocates. The linear phase FIR filters with integer
+    // latency line the factors up exactly once each is delayed to the
+    // latency of the slowest, so the latency never changes with the factor.
+    void prepare(const juce::dsp::ProcessSpec& spec) {
+        sampleRate = spec.sampleRate;
+        latency = 0;
+        
+        for (size_t order = 0; order < oversamplers.size(); order++) {
+            oversamplers[order] = std::make_unique<juce::dsp::Oversampling<SampleType>>(spec.numChannels,
+                                                                                      order,
+                                                                                      juce::dsp::Oversampling<SampleType>::filterHalfBandFIREquiripple,
+                                                                                      true,
+                                                                                      true);
+            oversamplers[order]->initProcessing(spec.maximumBlockSize);
+            latency = std::max(latency, juce::roundToInt(oversamplers[order]->getLatencyInSamples()));
+        }
+        
+        for (size_t order = 0; order < oversamplers.size(); order++) {
+            auto& pad = latencyPads[order];
+            pad.delay = latency - juce::roundToInt(oversamplers[order]->getLatencyInSamples());
+            pad.buffer.setSize(static_cast<int>(spec.numChannels), std::max(pad.delay, 1));
+        }
+        
+        crossfadeBuffer.setSize(static_cast<int>(spec.numChannels), static_cast<int>(spec.maximumBlockSize));
+        fadeLength = std::max(1, juce::roundToInt(oversamplingCrossfadeTime * sampleRate));
+        settleLength = std::max(latency, juce::roundToInt(oversamplingSettleTime * sampleRate));
+        multiband.prepare(spec, maxOversamplingOrder);
+        reset();
     }
     
-    void reset() override {
+    void reset() {
+        for (size_t order = 0; order < oversamplers.size(); order++) {
+            resetOrder(order);
+        }
         
+        activeOrder = targetOrder;
+        fadePosition = settleLength + fadeLength;
+        saturator.reset();
+        multiband.reset();
     }
     
-    void process(const juce::dsp::ProcessContextReplacing<float>& context) override {
-        // Get input blocks
+    // Same for every oversampling factor, report it to the host
+    int getLatencyInSamples() const { return latency; }
+    
+    // Time it takes to fade from one saturation type to another
+    void setSaturationCrossfadeTime(double seconds) {
+        jassert(seconds > 0.0);
+        saturationCrossfadeTime = seconds;
+    }
+    
+    double getSaturationCrossfadeTime() const { return saturationCrossfadeTime; }
+    
+    // Per sample scale of the pre gain for the next block, applied before
+    // oversampling. Pass nullptr to leave it unmodulated.
+    void setPreGainModulation(const SampleType* left, const SampleType* right) {
+        preGainModulation[0] = left;
+        preGainModulation[1] = right;
+    }
+    
+    // The new factor starts from silence next to the old one and is faded in
+    // once it has settled
+    void setOversamplingOrder(size_t order) {
+        jassert(order <= maxOversamplingOrder);
+        targetOrder = std::min(order, maxOversamplingOrder);
+    }
+    
+    size_t getOversamplingOrder() const { return targetOrder; }
+    
+    template <typename ProcessContext>
+    void process(const ProcessContext& context) {
         const auto& inputBlock = context.getInputBlock();
         auto& outputBlock = context.getOutputBlock();
         
-        const auto inputNumChannels = inputBlock.getNumChannels();
-        const auto outputNumChannels = outputBlock.getNumChannels();
+        if (context.usesSeparateInputAndOutputBlocks()) {
+            outputBlock.copyFrom(inputBlock);
+        }
+        
+        // If you hit this assertion prepare() has not been called
+        jassert(oversamplers[activeOrder] != nullptr);
         
-        const float* input[inputNumChannels];
+        const auto numSamples = outputBlock.getNumSamples();
+        
+        // The pre gain is linear, so it can be modulated at the base rate
+        for (size_t channel = 0; channel < std::min(outputBlock.getNumChannels(), static_cast<size_t>(2)); channel++) {
+            if (preGainModulation[channel] != nullptr) {
+                juce::FloatVectorOperations::multiply(outputBlock.getChannelPointer(channel), preGainModulation[channel], static_cast<int>(numSamples));
+            }
+        }
         
-        // Get channel pointers
-        for (size_t i = 0; i < inputNumChannels; i++) {
-            input[i] = inputBlock.getChannelPointer(i);
+        // A new factor is only taken once the running fade has finished
+        if (! isFading() && targetOrder != activeOrder) {
+            fadingOutOrder = activeOrder;
+            activeOrder = targetOrder;
+            resetOrder(activeOrder);
+            fadePosition = 0;
         }
         
-        float* output[outputNumChannels];
+        multiband.startBlock();
         
-        for (size_t i = 0; i < outputNumChannels; i++) {
-            output[i] = outputBlock.getChannelPointer(i);
+        if (! isFading()) {
+            processOversampled(activeOrder, outputBlock);
+            multiband.finishBlock(static_cast<unsigned int>(numSamples), activeOrder);
+            return;
         }
         
-        // Do processing
-        saturator.process(output, input, static_cast<unsigned int>(inputNumChannels), static_cast<unsigned int>(inputBlock.getNumSamples()));
+        // If you hit this assertion the block is longer than the one prepare() was called with
+        jassert(numSamples <= static_cast<size_t>(crossfadeBuffer.getNumSamples()));
         
+        // Both factors render the same block from the same saturator state,
+        // the type crossfade only moves on once
+        auto fadeBlock = juce::dsp::AudioBlock<SampleType>(crossfadeBuffer)
+                             .getSubsetChannelBlock(0, outputBlock.getNumChannels())
+                             .getSubBlock(0, numSamples);
+        fadeBlock.copyFrom(outputBlock);
+        
+        processOversampled(fadingOutOrder, fadeBlock);
+        processOversampled(activeOrder, outputBlock);
+        multiband.finishBlock(static_cast<unsigned int>(numSamples), activeOrder);
+        
+        for (size_t channel = 0; channel < outputBlock.getNumChannels(); channel++) {
+            auto* output = outputBlock.getChannelPointer(channel);
+            const auto* faded = fadeBlock.getChannelPointer(channel);
+            
+            for (size_t sample = 0; sample < numSamples; sample++) {
+                const auto position = fadePosition + static_cast<int>(sample) + 1 - settleLength;
+                const auto gain = static_cast<SampleType>(juce::jlimit(0, fadeLength, position)) / static_cast<SampleType>(fadeLength);
+                output[sample] = faded[sample] + gain * (output[sample] - faded[sample]);
+            }
+        }
+        
+        fadePosition = std::min(fadePosition + static_cast<int>(numSamples), settleLength + fadeLength);
     }
     
-    Saturator saturator;
+    Saturator<SampleType> saturator;
+    
+    // Runs the full band saturator with one band and the band saturators
+    // with more, and crossfades between band counts
+    MultibandSaturator<SampleType> multiband;
     
 private:
+    // Delays the output of one factor up to the latency of the slowest
+    struct LatencyPad
+    {
+        juce::AudioBuffer<SampleType> buffer;
+        int delay { 0 };
+        int index { 0 };
+        
+        void process(juce::dsp::AudioBlock<SampleType>& block)
+        {
+            if (delay == 0) {
+                return;
+            }
+            
+            const auto numSamples = static_cast<int>(block.getNumSamples());
+            
+            for (size_t channel = 0; channel < block.getNumChannels(); channel++) {
+                auto* samples = block.getChannelPointer(channel);
+                auto* line = buffer.getWritePointer(static_cast<int>(channel));
+                auto position = index;
+                
+                for (int i = 0; i < numSamples; i++) {
+                    std::swap(samples[i], line[position]);
+                    position = position + 1 < delay ? position + 1 : 0;
+                }
+            }
+            
+            index = (index + numSamples) % delay;
+        }
+        
+        void reset()
+        {
+            buffer.clear();
+            index = 0;
+        }
+    };
+    
+    bool isFading() const { return fadePosition < settleLength + fadeLength; }
+    
+    void resetOrder(size_t order) {
+        if (oversamplers[order] != nullptr) {
+            oversamplers[order]->reset();
+        }
+        
+        latencyPads[order].reset();
+        multiband.resetBank(order);
+    }
+    
+    void processOversampled(size_t order, juce::dsp::AudioBlock<SampleType>& block) {
+        auto& oversampler = *oversamplers[order];
+        auto oversampledBlock = oversampler.processSamplesUp(block);
+        
+        // The saturator runs at the oversampled rate
+        const auto oversampledRate = sampleRate * static_cast<double>(oversampler.getOversamplingFactor());
+        const auto crossfadeLength = std::max(1, juce::roundToInt(saturationCrossfadeTime * oversampledRate));
+        saturator.setCrossfadeLength(crossfadeLength);
+        multiband.setCrossfadeLength(crossfadeLength);
+        
+        // The saturator only handles up to 2 channels
+        SampleType* channels[2] { nullptr, nullptr };
+        const auto numChannels = std::min(oversampledBlock.getNumChannels(), static_cast<size_t>(2));
+        
+        for (size_t i = 0; i < numChannels; i++) {
+            channels[i] = oversampledBlock.getChannelPointer(i);
+        }
+        
+        multiband.render(channels, static_cast<unsigned int>(numChannels), static_cast<unsigned int>(oversampledBlock.getNumSamples()), order);
+        
+        oversampler.processSamplesDown(block);
+        latencyPads[order].process(block);
+    }
+    
+    std::array<std::unique_ptr<juce::dsp::Oversampling<SampleType>>, maxOversamplingOrder + 1> oversamplers;
+    std::array<LatencyPad, maxOversamplingOrder + 1> latencyPads;
+    juce::AudioBuffer<SampleType> crossfadeBuffer;
+    double sampleRate { 44100.0 };
+    double saturationCrossfadeTime { 0.01 };
+    const SampleType* preGainModulation[2] { nullptr, nullptr };
+    int latency { 0 };
+    
+    // Factor fade, fadingOutOrder is only processed while it runs
+    size_t activeOrder { 0 };
+    size_t targetOrder { 0 };
+    size_t fadingOutOrder { 0 };
+    int settleLength { 0 };
+    int fadeLength { 1 };
+    int fadePosition { 1 };
+    
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SaturatorProcessor)
 };
 
 
+template <typename SampleType>
 class Steamer {
 public:
-    Steamer() {}
+    using NoiseShaping = sauna::NoiseShaping;
+    
+    Steamer() { setGain(-12.f); }
     ~Steamer() {}
     
     // No copy semantics
@@ -218,12 +1147,37 @@ public:
     Steamer(Steamer&&) = delete;
     const Steamer& operator=(Steamer&&) = delete;
     
-    void prepare() {setGain(-12.f); }
+    void prepare(const juce::dsp::ProcessSpec& spec) {
+        juce::ignoreUnused(spec);
+        reset();
+    }
     
-    float getGain() { return gain; }
-    void setGain(float db) { gain = juce::Decibels::decibelsToGain(db); }
+    // Also restarts the noise sequence, renders of the same input are identical
+    void reset() {
+        std::fill(std::begin(pinkState[0]), std::end(pinkState[0]), static_cast<SampleType>(0));
+        std::fill(std::begin(pinkState[1]), std::end(pinkState[1]), static_cast<SampleType>(0));
+        random.setSeed(noiseSeed);
+    }
+    
+    // Moves the noise to where it would be numSamples samples after reset()
+    // with the given number of channels, so instances that each render a part
+    // of one signal draw the noise a single instance would. juce::Random is a
+    // 48 bit linear congruential generator, so this jumps ahead in log2 steps
+    // instead of drawing every value. The shaping filters start from silence.
+    void setNoisePosition(juce::int64 numSamples, int numChannels) {
+        jassert(numSamples >= 0);
+        const auto numDraws = static_cast<juce::uint64>(std::max<juce::int64>(numSamples, 0))
+                            * static_cast<juce::uint64>(juce::jlimit(1, 2, numChannels));
+        random.setSeed(static_cast<juce::int64>(jumpAhead(static_cast<juce::uint64>(noiseSeed), numDraws)));
+    }
+    
+    SampleType getGain() { return gain; }
+    void setGain(float db) { gain = juce::Decibels::decibelsToGain(static_cast<SampleType>(db)); }
+    
+    void setNoiseShaping(NoiseShaping newShaping) { noiseShaping = newShaping; }
+    NoiseShaping getNoiseShaping() const { return noiseShaping; }
 
-    void process(float* const* output, const float* const* input, unsigned int numChannels, unsigned int numSamples) {
+    void process(SampleType* const* output, const SampleType* const* input, unsigned int numChannels, unsigned int numSamples) {
         
         // To avoid using it in more than 2 channels
         numChannels = std::min(numChannels, 2u);
@@ -233,86 +1187,434 @@ public:
             for (unsigned int sample = 0; sample < numSamples; sample++)
             {
                 // Unity gain for testing
-                output[channel][sample] += random.nextFloat() * 0.25f - 0.125f;
+                output[channel][sample] += static_cast<SampleType>(random.nextFloat() * 0.25f - 0.125f);
             }
         }
     }
     
-    void process(float*  left,
-                 float*  right,
+    void process(SampleType*  left,
+                 SampleType*  right,
                  const float*  modInput,
                  unsigned int numChannels,
                  unsigned int numSamples)
     {
-        if (left == right) {
-            *left += random.nextFloat() * (modInput[0]) * gain ;
-        }else {
-            *left += random.nextFloat() * modInput[0] * gain;
-            *right += random.nextFloat() * modInput[1] * gain;
+        juce::ignoreUnused(numChannels);
+        const auto modLeft = static_cast<SampleType>(modInput[0]) * gain;
+        const auto modRight = static_cast<SampleType>(modInput[1]) * gain;
+        
+        for (unsigned int sample = 0; sample < numSamples; sample++)
+        {
+            if (left == right) {
+                left[sample] += nextNoise(0) * modLeft;
+            }else {
+                left[sample] += nextNoise(0) * modLeft;
+                right[sample] += nextNoise(1) * modRight;
+            }
+        }
+    }
+    
+    // Same as above with a modulation value per sample
+    void process(SampleType*  left,
+                 SampleType*  right,
+                 const SampleType*  modLeft,
+                 const SampleType*  modRight,
+                 unsigned int numChannels,
+                 unsigned int numSamples)
+    {
+        juce::ignoreUnused(numChannels);
+        
+        for (unsigned int sample = 0; sample < numSamples; sample++)
+        {
+            if (left == right) {
+                left[sample] += nextNoise(0) * modLeft[sample] * gain;
+            }else {
+                left[sample] += nextNoise(0) * modLeft[sample] * gain;
+                right[sample] += nextNoise(1) * modRight[sample] * gain;
+            }
         }
     }
     
 private:
+    // Unipolar noise in [0, 1), shaping is applied around its mean so every
+    // setting keeps the same offset and roughly the same level. The noise is
+    // drawn as float so float and double instances produce the same sequence.
+    SampleType nextNoise(int channel)
+    {
+        const auto white = static_cast<SampleType>(random.nextFloat());
+        
+        if (noiseShaping == NoiseShaping::None) {
+            return white;
+        }
+        
+        const auto x = white - static_cast<SampleType>(0.5);
+        auto* b = pinkState[channel];
+        
+        if (noiseShaping == NoiseShaping::Economy) {
+            b[0] = static_cast<SampleType>(0.99765) * b[0] + x * static_cast<SampleType>(0.0990460);
+            b[1] = static_cast<SampleType>(0.96300) * b[1] + x * static_cast<SampleType>(0.2965164);
+            b[2] = static_cast<SampleType>(0.57000) * b[2] + x * static_cast<SampleType>(1.0526913);
+            return static_cast<SampleType>(0.5) + static_cast<SampleType>(0.338) * (b[0] + b[1] + b[2] + x * static_cast<SampleType>(0.1848));
+        }
+        
+        b[0] = static_cast<SampleType>(0.99886) * b[0] + x * static_cast<SampleType>(0.0555179);
+        b[1] = static_cast<SampleType>(0.99332) * b[1] + x * static_cast<SampleType>(0.0750759);
+        b[2] = static_cast<SampleType>(0.96900) * b[2] + x * static_cast<SampleType>(0.1538520);
+        b[3] = static_cast<SampleType>(0.86650) * b[3] + x * static_cast<SampleType>(0.3104856);
+        b[4] = static_cast<SampleType>(0.55000) * b[4] + x * static_cast<SampleType>(0.5329522);
+        b[5] = static_cast<SampleType>(-0.7616) * b[5] - x * static_cast<SampleType>(0.0168980);
+        const auto pink = b[0] + b[1] + b[2] + b[3] + b[4] + b[5] + b[6] + x * static_cast<SampleType>(0.5362);
+        b[6] = x * static_cast<SampleType>(0.115926);
+        return static_cast<SampleType>(0.5) + static_cast<SampleType>(0.331) * pink;
+    }
+    
+    // Applies numDraws steps of juce::Random::nextInt() to seed
+    static juce::uint64 jumpAhead(juce::uint64 seed, juce::uint64 numDraws) {
+        constexpr juce::uint64 mask = 0xffffffffffffULL;
+        juce::uint64 multiplier = 0x5deece66dULL;
+        juce::uint64 increment = 11;
+        juce::uint64 totalMultiplier = 1;
+        juce::uint64 totalIncrement = 0;
+        
+        for (; numDraws > 0; numDraws >>= 1) {
+            if ((numDraws & 1) != 0) {
+                totalMultiplier = (totalMultiplier * multiplier) & mask;
+                totalIncrement = (totalIncrement * multiplier + increment) & mask;
+            }
+            
+            increment = (increment * multiplier + increment) & mask;
+            multiplier = (multiplier * multiplier) & mask;
+        }
+        
+        return (totalMultiplier * seed + totalIncrement) & mask;
+    }
+    
+    // Same seed as a default constructed juce::Random
+    static constexpr juce::int64 noiseSeed = 1;
+    
     juce::Random random;
-    float gain;
+    SampleType gain { 0 };
+    NoiseShaping noiseShaping { NoiseShaping::None };
+    SampleType pinkState[2][7] {};
 };
 
 
-class SteamerProcessor : public juce::dsp::ProcessorBase {
+// Adds the steam noise and the sizzle grains to a juce::dsp block, scaled
+// per sample by the ramps passed to setModulation() and
+// setSizzleModulation() before each block
+template <typename SampleType>
+class SteamerProcessor {
 public:
     SteamerProcessor() {};
     ~SteamerProcessor() {};
     
-    void prepare(const juce::dsp::ProcessSpec& spec) override
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        steamer.prepare(spec);
+        sizzle.prepare(spec);
+    }
+    
+    void reset() {
+        steamer.reset();
+        sizzle.reset();
+    }
+    
+    // The ramps must hold at least as many samples as the next block, pass
+    // nullptr to leave the steam unmodulated
+    void setModulation(const SampleType* left, const SampleType* right)
+    {
+        modulation[0] = left;
+        modulation[1] = right;
+    }
+    
+    // Density ramps of the sizzle, same rules as setModulation()
+    void setSizzleModulation(const SampleType* left, const SampleType* right)
     {
+        sizzleModulation[0] = left;
+        sizzleModulation[1] = right;
     }
     
-    void process(const juce::dsp::ProcessContextReplacing<float>& context) override
+    template <typename ProcessContext>
+    void process(const ProcessContext& context)
     {
-        // Do processing here
         const auto& inputBlock = context.getInputBlock();
         auto& outputBlock = context.getOutputBlock();
         
-        const auto inputNumChannels = inputBlock.getNumChannels();
-        const auto outputNumChannels = outputBlock.getNumChannels();
+        if (context.usesSeparateInputAndOutputBlocks()) {
+            outputBlock.copyFrom(inputBlock);
+        }
         
+        // The steamer only handles up to 2 channels, a mono block gets one noise stream
+        const auto numChannels = std::min(outputBlock.getNumChannels(), static_cast<size_t>(2));
+        auto* left = outputBlock.getChannelPointer(0);
+        auto* right = numChannels > 1 ? outputBlock.getChannelPointer(1) : left;
         
-        const float* input[inputNumChannels];
-        for (int i = 0; i < inputBlock.getNumChannels(); i++){
-            input[i] = inputBlock.getChannelPointer(i);
-        }
+        const auto numSamples = static_cast<unsigned int>(outputBlock.getNumSamples());
         
-        float* output[outputNumChannels];
-        for (int i = 0; i < outputBlock.getNumChannels(); i++){
-            output[i] = outputBlock.getChannelPointer(i);
+        if (modulation[0] == nullptr || modulation[1] == nullptr) {
+            const float unity[2] { 1.f, 1.f };
+            steamer.process(left, right, unity, static_cast<unsigned int>(numChannels), numSamples);
+        } else {
+            steamer.process(left, right, modulation[0], modulation[1], static_cast<unsigned int>(numChannels), numSamples);
         }
         
-        steamer.process(output, input, static_cast<unsigned int>(inputBlock.getNumChannels()), static_cast<unsigned int>(inputBlock.getNumSamples()));
+        sizzle.process(left, right, sizzleModulation[0], sizzleModulation[1], static_cast<int>(numSamples));
     }
     
-    void reset() override {
-        
-    }
+    Steamer<SampleType> steamer;
+    SizzleGenerator<SampleType> sizzle;
     
 private:
-    Steamer steamer;
+    const SampleType* modulation[2] { nullptr, nullptr };
+    const SampleType* sizzleModulation[2] { nullptr, nullptr };
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SteamerProcessor)
 };
 
 
-class SteamerReverb : public juce::Reverb
+template <typename SampleType>
+class SteamerReverb : public ReverbCore<SampleType>
 {
 public:
-    SteamerReverb() : juce::Reverb() {};
+    SteamerReverb() : ReverbCore<SampleType>() {};
+    
+    // Allocates both the full rate and the half rate reverb
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        this->setSampleRate(spec.sampleRate);
+        halfRateReverb.setSampleRate(spec.sampleRate / 2.0);
+        scratch.setSize(4, static_cast<int>(spec.maximumBlockSize));
+        fadeLength = std::max(1, juce::roundToInt(rateCrossfadeTime * spec.sampleRate));
+        reset();
+    }
+    
+    void reset()
+    {
+        ReverbCore<SampleType>::reset();
+        resetHalfRate();
+        rateDivisor = targetRateDivisor;
+        fadePosition = fadeLength;
+    }
+    
+    void setParameters(const juce::Reverb::Parameters& newParams)
+    {
+        ReverbCore<SampleType>::setParameters(newParams);
+        
+        // The dry signal bypasses the half rate path
+        auto halfRateParams = newParams;
+        halfRateParams.dryLevel = 0.0f;
+        halfRateReverb.setParameters(halfRateParams);
+    }
+    
+    // Runs the reverb at sampleRate / divisor, 1 and 2 are supported. The
+    // reverb at the new rate takes over the tail of the old one and both run
+    // side by side while the new one fades in over rateCrossfadeTime.
+    void setRateDivisor(int divisor)
+    {
+        jassert(divisor == 1 || divisor == 2);
+        targetRateDivisor = divisor == 2 ? 2 : 1;
+    }
+    
+    int getRateDivisor() const { return targetRateDivisor; }
+    
+    template <typename ProcessContext>
+    void process(const ProcessContext& context)
+    {
+        const auto& inputBlock = context.getInputBlock();
+        auto& outputBlock = context.getOutputBlock();
+        
+        if (context.usesSeparateInputAndOutputBlocks()) {
+            outputBlock.copyFrom(inputBlock);
+        }
+        
+        const auto numChannels = std::min(outputBlock.getNumChannels(), static_cast<size_t>(2));
+        auto* left = outputBlock.getChannelPointer(0);
+        auto* right = numChannels > 1 ? outputBlock.getChannelPointer(1) : left;
+        
+        process(left, right, nullptr, static_cast<unsigned int>(numChannels), static_cast<unsigned int>(outputBlock.getNumSamples()));
+    }
     
-    void process(float*  left, //readArray
-                 float*  right, //writeArray
+    void process(SampleType*  left, //readArray
+                 SampleType*  right, //writeArray
                  const float*  modInput,
                  unsigned int numChannels,
                  unsigned int numSamples)
     {
-        processStereo (left, right, numSamples);
+        juce::ignoreUnused(modInput);
+        const auto isMono = left == right || numChannels < 2;
+        const auto n = static_cast<int>(numSamples);
+        
+        // A new rate is only taken once the running fade has finished
+        if (! isFading() && targetRateDivisor != rateDivisor) {
+            startRateFade();
+        }
+        
+        if (! isFading()) {
+            processAtRate(rateDivisor, left, right, isMono, n);
+            return;
+        }
+        
+        // The sub blocks of a modulated room size can be shorter than the
+        // fade, blocks longer than the scratch are faded in pieces
+        for (int start = 0; start < n; start += scratch.getNumSamples()) {
+            const auto length = std::min(n - start, scratch.getNumSamples());
+            processFade(left + start, isMono ? left + start : right + start, isMono, length);
+        }
     }
+    
+    // Length of the fade between the two rates
+    static constexpr double rateCrossfadeTime = 0.02;
+    
 private:
+    bool isFading() const { return fadePosition < fadeLength; }
+    
+    // The reverb at the new rate continues the tail of the old one, neither
+    // is reset
+    void startRateFade()
+    {
+        if (targetRateDivisor == 2) {
+            halfRateReverb.copyStateFrom(*this);
+            hasPendingSample = false;
+            wetPrevious[0] = wetPrevious[1] = 0;
+            wetCurrent[0] = wetCurrent[1] = 0;
+        } else {
+            ReverbCore<SampleType>::copyStateFrom(halfRateReverb);
+        }
+        
+        fadingOutDivisor = rateDivisor;
+        rateDivisor = targetRateDivisor;
+        fadePosition = 0;
+    }
+    
+    // The old rate runs on a copy of the input and the new one fades in over
+    // it, carrying on from where the previous block stopped
+    void processFade(SampleType* left, SampleType* right, bool isMono, int numSamples)
+    {
+        auto* oldLeft = scratch.getWritePointer(0);
+        auto* oldRight = isMono ? oldLeft : scratch.getWritePointer(1);
+        
+        juce::FloatVectorOperations::copy(oldLeft, left, numSamples);
+        if (! isMono) {
+            juce::FloatVectorOperations::copy(oldRight, right, numSamples);
+        }
+        
+        processAtRate(fadingOutDivisor, oldLeft, oldRight, isMono, numSamples);
+        processAtRate(rateDivisor, left, right, isMono, numSamples);
+        
+        for (int i = 0; i < numSamples; i++) {
+            const auto gain = static_cast<SampleType>(std::min(fadePosition + i + 1, fadeLength)) / static_cast<SampleType>(fadeLength);
+            left[i] = oldLeft[i] + gain * (left[i] - oldLeft[i]);
+            
+            if (! isMono) {
+                right[i] = oldRight[i] + gain * (right[i] - oldRight[i]);
+            }
+        }
+        
+        fadePosition = std::min(fadePosition + numSamples, fadeLength);
+    }
+    
+    void processAtRate(int divisor, SampleType* left, SampleType* right, bool isMono, int numSamples)
+    {
+        if (divisor == 2) {
+            processHalfRate(left, right, isMono, numSamples);
+        } else if (isMono) {
+            this->processMono(left, numSamples);
+        } else {
+            this->processStereo(left, right, numSamples);
+        }
+    }
+    
+    // Pairs of samples are averaged into the half rate reverb, its output is
+    // linearly interpolated back up. The pair phase is carried across blocks
+    // so odd block sizes work.
+    void processHalfRate(SampleType* left, SampleType* right, bool isMono, int numSamples)
+    {
+        auto* halfLeft = scratch.getWritePointer(2);
+        auto* halfRight = scratch.getWritePointer(3);
+        
+        // Same scaling as juce::Reverb
+        const auto dryGain = static_cast<SampleType>(this->getParameters().dryLevel * 2.0f);
+        const auto startsMidPair = hasPendingSample;
+        int numHalfSamples = 0;
+        
+        for (int i = 0; i < numSamples; i++) {
+            const auto r = isMono ? left[i] : right[i];
+            
+            if (! hasPendingSample) {
+                pendingSample[0] = left[i];
+                pendingSample[1] = r;
+                hasPendingSample = true;
+            } else {
+                halfLeft[numHalfSamples] = static_cast<SampleType>(0.5) * (pendingSample[0] + left[i]);
+                halfRight[numHalfSamples] = static_cast<SampleType>(0.5) * (pendingSample[1] + r);
+                numHalfSamples++;
+                hasPendingSample = false;
+            }
+        }
+        
+        if (isMono) {
+            halfRateReverb.processMono(halfLeft, numHalfSamples);
+        } else {
+            halfRateReverb.processStereo(halfLeft, halfRight, numHalfSamples);
+        }
+        
+        auto midPair = startsMidPair;
+        int k = 0;
+        
+        for (int i = 0; i < numSamples; i++) {
+            SampleType wet[2];
+            
+            if (! midPair) {
+                wet[0] = static_cast<SampleType>(0.5) * (wetPrevious[0] + wetCurrent[0]);
+                wet[1] = static_cast<SampleType>(0.5) * (wetPrevious[1] + wetCurrent[1]);
+            } else {
+                wetPrevious[0] = wetCurrent[0];
+                wetPrevious[1] = wetCurrent[1];
+                wetCurrent[0] = halfLeft[k];
+                wetCurrent[1] = isMono ? halfLeft[k] : halfRight[k];
+                k++;
+                wet[0] = wetPrevious[0];
+                wet[1] = wetPrevious[1];
+            }
+            
+            midPair = ! midPair;
+            left[i] = left[i] * dryGain + wet[0];
+            
+            if (! isMono) {
+                right[i] = right[i] * dryGain + wet[1];
+            }
+        }
+    }
+    
+    void resetHalfRate()
+    {
+        halfRateReverb.reset();
+        hasPendingSample = false;
+        pendingSample[0] = pendingSample[1] = 0;
+        wetPrevious[0] = wetPrevious[1] = 0;
+        wetCurrent[0] = wetCurrent[1] = 0;
+    }
+    
+    ReverbCore<SampleType> halfRateReverb;
+    juce::AudioBuffer<SampleType> scratch;
+    int rateDivisor { 1 };
+    int targetRateDivisor { 1 };
+    
+    // Rate fade, fadingOutDivisor is only processed while it runs
+    int fadingOutDivisor { 1 };
+    int fadeLength { 1 };
+    int fadePosition { 1 };
+    
+    // Half rate decimation and interpolation state
+    bool hasPendingSample { false };
+    SampleType pendingSample[2] { 0, 0 };
+    SampleType wetPrevious[2] { 0, 0 };
+    SampleType wetCurrent[2] { 0, 0 };
 };
 
 } // end sauna namespace
+
+#include "sauna_QualityTier.h"
+#include "sauna_StageProfiler.h"
+#include "sauna_ModulationMatrix.h"
+#include "sauna_ExciterChain.h"
+#include "sauna_ExciterPipeline.h"